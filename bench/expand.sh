@@ -0,0 +1,48 @@
+#!/usr/bin/env bash
+#
+# Throughput of variable expansion for words with many variable references.
+#
+# Usage: bench/expand.sh [mysh] [lines] [refs]
+#
+# Every line assigns a word made of many references to a 128-byte variable, so
+# that the time is spent expanding rather than running commands.
+
+set -euo pipefail
+
+MYSH=${1:-src/mysh}
+LINES=${2:-100000}
+REFS=${3:-32}
+VALUE_LEN=128
+
+script=$(mktemp)
+trap 'rm -f "$script"' EXIT
+
+# mix the forms of references
+word=""
+for ((i = 0; i < REFS; i++)); do
+    case $((i % 4)) in
+        0) word+='$v' ;;
+        1) word+='${v}' ;;
+        2) word+='${unset:-$v}' ;;
+        3) word+='${#v}' ;;
+    esac
+done
+
+{
+    printf 'v=%0*d\n' "$VALUE_LEN" 0
+    for ((i = 0; i < LINES; i++)); do
+        echo "w=$word"
+    done
+} > "$script"
+
+start=$(date +%s.%N)
+"$MYSH" "$script" > /dev/null
+end=$(date +%s.%N)
+
+awk -v lines="$LINES" -v refs="$REFS" -v start="$start" -v end="$end" '
+    BEGIN {
+        seconds = end - start
+        printf "%-12s %10s %14s\n", "references", "seconds", "references/s"
+        printf "%-12d %10.3f %14.0f\n", lines * refs, seconds,
+               lines * refs / seconds
+    }'
@@ -0,0 +1,30 @@
+#!/usr/bin/env bash
+#
+# Throughput of a 4-stage pipeline at several pipe buffer sizes.
+#
+# Usage: bench/pipe_size.sh [mysh] [bytes]
+#
+# External commands are used for every stage, so that the data really passes
+# through the pipes created by mysh.
+
+set -euo pipefail
+
+MYSH=${1:-src/mysh}
+BYTES=${2:-1073741824}  # 1 GiB
+SIZES="65536 262144 1048576"
+
+PIPELINE="head -c $BYTES /dev/zero | /bin/cat | /bin/cat | /usr/bin/wc -c"
+
+printf '%-10s %10s %12s\n' "pipe size" "seconds" "MiB/s"
+for size in $SIZES; do
+    start=$(date +%s.%N)
+    MYSH_PIPE_SIZE=$size "$MYSH" -c "$PIPELINE" > /dev/null
+    end=$(date +%s.%N)
+
+    awk -v size="$size" -v bytes="$BYTES" -v start="$start" -v end="$end" '
+        BEGIN {
+            seconds = end - start
+            printf "%-10d %10.3f %12.1f\n", size, seconds,
+                   bytes / 1048576 / seconds
+        }'
+done
@@ -0,0 +1,134 @@
+#define _GNU_SOURCE
+
+#include "affinity.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io_helpers.h"
+#include "variables.h"
+
+#define CPUSET_VAR    "MYSH_CPUSET"
+#define SPREAD_PREFIX "spread:"
+#define PIN_PREFIX    "pin"
+
+/**
+ * @brief Parse a list of CPUs like 0-3,8,10-11.
+ * @return false if the list is invalid.
+ */
+static bool parse_cpus(const char *text, cpu_set_t *const cpus,
+                       size_t *const n_cpu) {
+    CPU_ZERO(cpus);
+    for (;;) {
+        if (!isdigit((unsigned char)*text)) return false;
+
+        char         *end;
+        unsigned long first = strtoul(text, &end, 10);
+        unsigned long last  = first;
+        if (*end == '-') {
+            text = end + 1;
+            if (!isdigit((unsigned char)*text)) return false;
+            last = strtoul(text, &end, 10);
+        }
+        if (first > last || last >= CPU_SETSIZE) return false;
+
+        for (; first <= last; first++) CPU_SET(first, cpus);
+
+        if (*end == '\0') break;
+        if (*end != ',') return false;
+        text = end + 1;
+    }
+
+    *n_cpu = CPU_COUNT(cpus);
+    return true;
+}
+
+/**
+ * @return The n-th CPU of a set, counting from 0.
+ */
+static int nth_cpu(const cpu_set_t *const cpus, size_t n) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, cpus) && n-- == 0) return cpu;
+    }
+    return -1;
+}
+
+void requested_placement(CpuPlacement *const placement) {
+    placement->n_cpu  = 0;
+    placement->spread = false;
+
+    const Variable *const var = find_variable(CPUSET_VAR, strlen(CPUSET_VAR));
+    if (var == NULL || var->value_len == 0) return;
+
+    const char *cpus = var->value;
+    if (strncmp(cpus, SPREAD_PREFIX, strlen(SPREAD_PREFIX)) == 0) {
+        placement->spread  = true;
+        cpus              += strlen(SPREAD_PREFIX);
+    }
+
+    if (!parse_cpus(cpus, &placement->cpus, &placement->n_cpu)) {
+        display_error("ERROR: Invalid %s: %s\n", CPUSET_VAR, var->value);
+        placement->n_cpu = 0;
+    }
+}
+
+bool take_pin_prefix(size_t *const argc, char *const **const argv,
+                     CpuPlacement *const placement) {
+    if (*argc == 0 || strcmp(PIN_PREFIX, (*argv)[0]) != 0) return true;
+
+    if (*argc < 3) {
+        display_error("ERROR: Usage: %s <cpus> <command> [<arg> ...]\n",
+                      PIN_PREFIX);
+        return false;
+    }
+
+    const char *const cpus = (*argv)[1];
+    if (!parse_cpus(cpus, &placement->cpus, &placement->n_cpu)) {
+        display_error("ERROR: %s: Invalid CPU list: %s\n", PIN_PREFIX, cpus);
+        return false;
+    }
+    placement->spread = false;
+
+    *argc -= 2;
+    *argv += 2;
+    return true;
+}
+
+void bind_stage(const CpuPlacement *const placement, const size_t i_stage,
+                CpuBinding *const binding) {
+    if (placement->n_cpu == 0) {
+        unbind_stages(binding);
+        return;
+    }
+
+    if (!binding->bound) {
+        if (sched_getaffinity(0, sizeof(cpu_set_t), &binding->saved) == -1) {
+            display_error("ERROR: Cannot get CPU affinity\n");
+            return;
+        }
+        binding->bound = true;
+    }
+
+    // one CPU per stage, so that adjacent stages share a cache
+    cpu_set_t        single;
+    const cpu_set_t *cpus = &placement->cpus;
+    if (placement->spread) {
+        CPU_ZERO(&single);
+        CPU_SET(nth_cpu(cpus, i_stage % placement->n_cpu), &single);
+        cpus = &single;
+    }
+
+    if (sched_setaffinity(0, sizeof(cpu_set_t), cpus) == -1) {
+        display_error("ERROR: Cannot set CPU affinity\n");
+    }
+}
+
+void unbind_stages(CpuBinding *const binding) {
+    if (!binding->bound) return;
+
+    if (sched_setaffinity(0, sizeof(cpu_set_t), &binding->saved) == -1) {
+        display_error("ERROR: Cannot restore CPU affinity\n");
+    }
+    binding->bound = false;
+}
@@ -0,0 +1,61 @@
+#ifndef __AFFINITY_H__
+#define __AFFINITY_H__
+
+#include <sched.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The CPUs the stages of a pipeline run on.
+ */
+typedef struct {
+    cpu_set_t cpus;
+    size_t    n_cpu;   // 0 to run where the shell runs
+    bool      spread;  // stage i runs on the i-th CPU only, in turn
+} CpuPlacement;
+
+/**
+ * The CPUs of the shell thread while it starts the stages of a pipeline.
+ */
+typedef struct {
+    cpu_set_t saved;  // CPUs of the thread before the first stage was bound
+    bool      bound;
+} CpuBinding;
+
+/**
+ * @brief Get the placement set by the MYSH_CPUSET variable, which may come from
+ * the environment: a list of CPUs like 0-3,8 for all stages, or spread:0-7 to
+ * run each stage of a pipeline on the next CPU of the list.
+ */
+void requested_placement(CpuPlacement *placement);
+
+/**
+ * @brief Take a leading `pin <cpus>` off a command, whose stage then runs on
+ * the listed CPUs.
+ *
+ * @param [in,out] argc The number of arguments, reduced by the prefix.
+ * @param [in,out] argv The arguments, advanced past the prefix.
+ * @param [out] placement Replaced if the command has the prefix.
+ * @return false if the list of CPUs is invalid or no command follows, which is
+ * displayed.
+ */
+bool take_pin_prefix(size_t *argc, char *const **argv,
+                     CpuPlacement *placement);
+
+/**
+ * @brief Bind the calling thread to the CPUs of a stage, so that the processes
+ * it spawns or forks inherit them. A stage without placement gets back the
+ * CPUs of the thread.
+ *
+ * @param [in] i_stage The index of the stage in its pipeline.
+ * @param [in,out] binding Starts unbound for each pipeline.
+ */
+void bind_stage(const CpuPlacement *placement, size_t i_stage,
+                CpuBinding *binding);
+
+/**
+ * @brief Give the calling thread back the CPUs it had before its binding.
+ */
+void unbind_stages(CpuBinding *binding);
+
+#endif
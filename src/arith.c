@@ -0,0 +1,475 @@
+#define _GNU_SOURCE
+
+#include "arith.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io_helpers.h"
+#include "utils/hash.h"
+#include "variables.h"
+
+#define ARITH_CACHE_SLOTS 128  // must be a power of 2
+
+typedef enum {
+    NODE_NUMBER,
+    NODE_VARIABLE,
+    NODE_NEGATE,
+    NODE_NOT,
+    NODE_COMPLEMENT,
+    NODE_MUL,
+    NODE_DIV,
+    NODE_MOD,
+    NODE_ADD,
+    NODE_SUB,
+    NODE_SHL,
+    NODE_SHR,
+    NODE_LT,
+    NODE_LE,
+    NODE_GT,
+    NODE_GE,
+    NODE_EQ,
+    NODE_NE,
+    NODE_BIT_AND,
+    NODE_BIT_XOR,
+    NODE_BIT_OR,
+    NODE_AND,
+    NODE_OR,
+    NODE_CONDITION,  // operands: condition, then, else
+} NodeType;
+
+typedef struct {
+    NodeType type;
+    union {
+        long long value;  // only for NODE_NUMBER
+        struct {
+            size_t begin;  // offset in the text of the expression
+            size_t len;
+        } name;              // only for NODE_VARIABLE
+        size_t operands[3];  // indices of the operand nodes
+    };
+} Node;
+
+/**
+ * An expression compiled into a tree of nodes. Operands precede the nodes
+ * using them, so the root is the last node.
+ */
+typedef struct {
+    uint64_t hash;
+    char    *text;  // NULL if the slot is empty
+    size_t   len;
+    Node    *nodes;
+    size_t   n_node;
+} CompiledExpr;
+
+// Direct-mapped: an expression replaces the one in its slot
+static CompiledExpr cache[ARITH_CACHE_SLOTS];
+
+void init_arith_cache() { memset(cache, 0, sizeof(cache)); }
+
+static void free_compiled(CompiledExpr *const expr) {
+    free(expr->text);
+    free(expr->nodes);
+    *expr = (CompiledExpr){.text = NULL, .nodes = NULL};
+}
+
+void free_arith_cache() {
+    for (size_t i = 0; i < ARITH_CACHE_SLOTS; i++) free_compiled(&cache[i]);
+}
+
+// ========== Compiler ==========
+
+typedef struct {
+    const char *symbol;
+    NodeType    type;
+    int         precedence;  // higher binds tighter
+} BinaryOp;
+
+// Longer symbols first, so that "<=" is not matched as "<"
+static const BinaryOp BINARY_OPS[] = {
+    {"||", NODE_OR, 1},      {"&&", NODE_AND, 2},     {"==", NODE_EQ, 6},
+    {"!=", NODE_NE, 6},      {"<=", NODE_LE, 7},      {">=", NODE_GE, 7},
+    {"<<", NODE_SHL, 8},     {">>", NODE_SHR, 8},     {"|", NODE_BIT_OR, 3},
+    {"^", NODE_BIT_XOR, 4},  {"&", NODE_BIT_AND, 5},  {"<", NODE_LT, 7},
+    {">", NODE_GT, 7},       {"+", NODE_ADD, 9},      {"-", NODE_SUB, 9},
+    {"*", NODE_MUL, 10},     {"/", NODE_DIV, 10},     {"%", NODE_MOD, 10},
+};
+
+#define N_BINARY_OPS (sizeof(BINARY_OPS) / sizeof(BINARY_OPS[0]))
+
+typedef struct {
+    const char *text;  // NUL-terminated
+    size_t      pos;
+    Node       *nodes;
+    size_t      n_node;
+    size_t      capacity;
+    bool        failed;
+} Compiler;
+
+static size_t compile_expr(Compiler *compiler);
+
+static size_t add_node(Compiler *const compiler, const Node node) {
+    if (compiler->n_node == compiler->capacity) {
+        compiler->capacity =
+            compiler->capacity == 0 ? 8 : compiler->capacity * 2;
+        compiler->nodes =
+            realloc(compiler->nodes, compiler->capacity * sizeof(Node));
+    }
+    compiler->nodes[compiler->n_node] = node;
+    return compiler->n_node++;
+}
+
+static char peek(Compiler *const compiler) {
+    while (isspace((unsigned char)compiler->text[compiler->pos])) {
+        compiler->pos++;
+    }
+    return compiler->text[compiler->pos];
+}
+
+static bool is_name_start(const char ch) {
+    return isalpha((unsigned char)ch) || ch == '_';
+}
+
+static bool is_name_char(const char ch) {
+    return isalnum((unsigned char)ch) || ch == '_';
+}
+
+/**
+ * @brief Compile a variable in braces, as in ${name}, ${1} or ${#}.
+ *
+ * @param [in,out] compiler Its position is on the '{'.
+ */
+static size_t compile_braced(Compiler *const compiler) {
+    const char *const text  = compiler->text;
+    const size_t      begin = ++compiler->pos;
+    if (text[begin] == '#') {
+        compiler->pos++;
+    } else if (isdigit((unsigned char)text[begin])) {
+        while (isdigit((unsigned char)text[compiler->pos])) compiler->pos++;
+    } else if (is_name_start(text[begin])) {
+        while (is_name_char(text[compiler->pos])) compiler->pos++;
+    }
+
+    const size_t end = compiler->pos;
+    if (end == begin || text[end] != '}') {
+        compiler->failed = true;
+        return 0;
+    }
+    compiler->pos++;
+
+    return add_node(compiler, (Node){.type = NODE_VARIABLE,
+                                     .name = {begin, end - begin}});
+}
+
+static size_t compile_operand(Compiler *const compiler) {
+    const char ch = peek(compiler);
+
+    if (ch == '-' || ch == '+' || ch == '!' || ch == '~') {
+        compiler->pos++;
+        const size_t operand = compile_operand(compiler);
+        if (ch == '+') return operand;
+
+        const NodeType type = ch == '-'   ? NODE_NEGATE
+                              : ch == '!' ? NODE_NOT
+                                          : NODE_COMPLEMENT;
+        return add_node(compiler,
+                        (Node){.type = type, .operands = {operand}});
+    }
+
+    if (ch == '(') {
+        compiler->pos++;
+        const size_t inner = compile_expr(compiler);
+        if (peek(compiler) != ')') {
+            compiler->failed = true;
+            return 0;
+        }
+        compiler->pos++;
+        return inner;
+    }
+
+    if (isdigit((unsigned char)ch)) {
+        const char *const begin = compiler->text + compiler->pos;
+        char             *end;
+        errno                 = 0;
+        const long long value = strtoll(begin, &end, 0);
+        if (errno != 0 || is_name_char(*end)) compiler->failed = true;
+
+        compiler->pos += end - begin;
+        return add_node(compiler, (Node){.type = NODE_NUMBER, .value = value});
+    }
+
+    // a variable, with or without '$', or in braces after '$'
+    if (ch == '$') {
+        compiler->pos++;
+        if (compiler->text[compiler->pos] == '{') {
+            return compile_braced(compiler);
+        }
+
+        // a positional parameter or $#, only with '$'
+        const size_t begin = compiler->pos;
+        if (compiler->text[begin] == '#') {
+            compiler->pos++;
+        } else {
+            while (isdigit((unsigned char)compiler->text[compiler->pos])) {
+                compiler->pos++;
+            }
+        }
+        if (compiler->pos > begin) {
+            return add_node(compiler,
+                            (Node){.type = NODE_VARIABLE,
+                                   .name = {begin, compiler->pos - begin}});
+        }
+    }
+    const size_t begin = compiler->pos;
+    if (!is_name_start(compiler->text[begin])) {
+        compiler->failed = true;
+        return 0;
+    }
+    while (is_name_char(compiler->text[compiler->pos])) compiler->pos++;
+
+    return add_node(compiler,
+                    (Node){.type = NODE_VARIABLE,
+                           .name = {begin, compiler->pos - begin}});
+}
+
+static const BinaryOp *match_binary(Compiler *const compiler) {
+    peek(compiler);
+    const char *const pos = compiler->text + compiler->pos;
+    for (size_t i = 0; i < N_BINARY_OPS; i++) {
+        const char *const symbol = BINARY_OPS[i].symbol;
+        if (strncmp(pos, symbol, strlen(symbol)) == 0) return &BINARY_OPS[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Compile binary operators binding at least as tight as min_precedence,
+ * by precedence climbing.
+ */
+static size_t compile_binary(Compiler *const compiler,
+                             const int min_precedence) {
+    size_t left = compile_operand(compiler);
+
+    while (!compiler->failed) {
+        const BinaryOp *const op = match_binary(compiler);
+        if (op == NULL || op->precedence < min_precedence) break;
+        compiler->pos += strlen(op->symbol);
+
+        // left associative
+        const size_t right = compile_binary(compiler, op->precedence + 1);
+        left               = add_node(
+            compiler, (Node){.type = op->type, .operands = {left, right}});
+    }
+    return left;
+}
+
+static size_t compile_expr(Compiler *const compiler) {
+    const size_t condition = compile_binary(compiler, 1);
+    if (compiler->failed || peek(compiler) != '?') return condition;
+    compiler->pos++;
+
+    const size_t then_expr = compile_expr(compiler);
+    if (peek(compiler) != ':') {
+        compiler->failed = true;
+        return 0;
+    }
+    compiler->pos++;
+    const size_t else_expr = compile_expr(compiler);
+
+    return add_node(compiler,
+                    (Node){.type     = NODE_CONDITION,
+                           .operands = {condition, then_expr, else_expr}});
+}
+
+/**
+ * @return Whether the text of expr is a valid expression, compiled into expr.
+ */
+static bool compile(CompiledExpr *const expr) {
+    Compiler compiler = {.text     = expr->text,
+                         .pos      = 0,
+                         .nodes    = NULL,
+                         .n_node   = 0,
+                         .capacity = 0,
+                         .failed   = false};
+
+    // an empty expression is 0
+    if (peek(&compiler) == '\0') {
+        add_node(&compiler, (Node){.type = NODE_NUMBER, .value = 0});
+    } else {
+        compile_expr(&compiler);
+        if (peek(&compiler) != '\0') compiler.failed = true;
+    }
+
+    if (compiler.failed) {
+        free(compiler.nodes);
+        return false;
+    }
+    expr->nodes  = compiler.nodes;
+    expr->n_node = compiler.n_node;
+    return true;
+}
+
+// ========== Evaluation ==========
+
+static bool eval_variable(const CompiledExpr *const expr,
+                          const Node *const node, long long *const result) {
+    const char *const     name = expr->text + node->name.begin;
+    const Variable *const var  = find_variable(name, node->name.len);
+    if (var == NULL || var->value_len == 0) {
+        *result = 0;
+        return true;
+    }
+
+    char *end;
+    errno   = 0;
+    *result = strtoll(var->value, &end, 0);
+    if (errno != 0 || *end != '\0') {
+        display_error("ERROR: Invalid number in %.*s: %s\n",
+                      (int)node->name.len, name, var->value);
+        return false;
+    }
+    return true;
+}
+
+static bool eval_node(const CompiledExpr *const expr, const size_t i,
+                      long long *const result) {
+    const Node *const node = &expr->nodes[i];
+
+    switch (node->type) {
+        case NODE_NUMBER:
+            *result = node->value;
+            return true;
+        case NODE_VARIABLE:
+            return eval_variable(expr, node, result);
+        default:
+            break;
+    }
+
+    // operators, which evaluate their first operand first
+    long long a;
+    if (!eval_node(expr, node->operands[0], &a)) return false;
+
+    switch (node->type) {
+        case NODE_NEGATE:
+            *result = (long long)(0ULL - (unsigned long long)a);
+            return true;
+        case NODE_NOT:
+            *result = !a;
+            return true;
+        case NODE_COMPLEMENT:
+            *result = ~a;
+            return true;
+
+        // short-circuit
+        case NODE_AND:
+        case NODE_OR:
+            if ((node->type == NODE_AND) != (a != 0)) {
+                *result = a != 0;
+                return true;
+            }
+            if (!eval_node(expr, node->operands[1], &a)) return false;
+            *result = a != 0;
+            return true;
+        case NODE_CONDITION:
+            return eval_node(expr, node->operands[a != 0 ? 1 : 2], result);
+
+        default:
+            break;
+    }
+
+    long long b;
+    if (!eval_node(expr, node->operands[1], &b)) return false;
+
+    // wrap around on overflow instead of undefined behavior
+    const unsigned long long ua = a;
+    const unsigned long long ub = b;
+
+    switch (node->type) {
+        case NODE_MUL:
+            *result = (long long)(ua * ub);
+            return true;
+        case NODE_DIV:
+        case NODE_MOD:
+            if (b == 0) {
+                display_error("ERROR: Division by zero\n");
+                return false;
+            }
+            if (b == -1) {  // LLONG_MIN / -1 overflows
+                *result = node->type == NODE_DIV ? (long long)(0ULL - ua) : 0;
+                return true;
+            }
+            *result = node->type == NODE_DIV ? a / b : a % b;
+            return true;
+        case NODE_ADD:
+            *result = (long long)(ua + ub);
+            return true;
+        case NODE_SUB:
+            *result = (long long)(ua - ub);
+            return true;
+        case NODE_SHL:
+            *result = (long long)(ua << (ub & 63));
+            return true;
+        case NODE_SHR:
+            *result = a >> (ub & 63);
+            return true;
+        case NODE_LT:
+            *result = a < b;
+            return true;
+        case NODE_LE:
+            *result = a <= b;
+            return true;
+        case NODE_GT:
+            *result = a > b;
+            return true;
+        case NODE_GE:
+            *result = a >= b;
+            return true;
+        case NODE_EQ:
+            *result = a == b;
+            return true;
+        case NODE_NE:
+            *result = a != b;
+            return true;
+        case NODE_BIT_AND:
+            *result = a & b;
+            return true;
+        case NODE_BIT_XOR:
+            *result = a ^ b;
+            return true;
+        case NODE_BIT_OR:
+            *result = a | b;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// ========== Public Interface ==========
+
+bool eval_arith(const char *const text, const size_t len,
+                long long *const result) {
+    const uint64_t      hash = hash_mem(text, len);
+    CompiledExpr *const slot = &cache[hash & (ARITH_CACHE_SLOTS - 1)];
+
+    if (slot->text == NULL || slot->hash != hash || slot->len != len ||
+        memcmp(slot->text, text, len) != 0) {
+        // compile, and replace the expression in the slot
+        CompiledExpr expr = {
+            .hash = hash, .text = strndup(text, len), .len = len};
+        if (!compile(&expr)) {
+            display_error("ERROR: Invalid arithmetic expression: %s\n",
+                          expr.text);
+            free(expr.text);
+            return false;
+        }
+        DEBUG_PRINT("DEBUG: Compiled arithmetic expression: %s\n", expr.text);
+
+        free_compiled(slot);
+        *slot = expr;
+    }
+
+    return eval_node(slot, slot->n_node - 1, result);
+}
@@ -0,0 +1,30 @@
+#ifndef __ARITH_H__
+#define __ARITH_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+void init_arith_cache();
+
+void free_arith_cache();
+
+/**
+ * @brief Evaluate an arithmetic expression, as in $((expr)).
+ *
+ * Supported are decimal, octal (0...) and hexadecimal (0x...) integers,
+ * variables as name, $name or ${name}, parentheses, the unary operators
+ * - + ! ~, the binary operators * / % + - << >> < <= > >= == != & ^ | && ||
+ * and the conditional operator ?:, with the precedence of C. An unset or empty
+ * variable is 0.
+ *
+ * Compiled expressions are cached by their text, so evaluating the same
+ * expression again only walks its tree.
+ *
+ * @param [in] expr The expression, which need not be NUL-terminated.
+ * @param [in] len The length of the expression.
+ * @param [out] result Receives the value.
+ * @return Whether the expression is valid. An error is displayed otherwise.
+ */
+bool eval_arith(const char *expr, size_t len, long long *result);
+
+#endif
@@ -1,33 +1,128 @@
-#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
 
 #include "background.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
+#include <unistd.h>
 
 #include "io_helpers.h"
+#include "variables.h"
+
+#define MAX_JOBS_VAR "MYSH_MAX_JOBS"
 
 // ========== Job List ==========
 
 static const size_t INIT_JOBS_CAPACITY = 16;
 
+// A slot of jobs is free if its pids is NULL. Free slots below jobs_len are
+// kept in free_slots to be reused by new jobs.
 static JobInfo* jobs          = NULL;
 static size_t   jobs_len      = 0;
 static size_t   jobs_capacity = 0;
 
+static size_t* free_slots   = NULL;
+static size_t  n_free_slots = 0;
+
+// Jobs whose processes have all finished but are not reported yet
+static size_t* finished_jobs   = NULL;
+static size_t  n_finished_jobs = 0;
+
+// Jobs waiting to start, in the order they were queued
+static size_t* queued_jobs = NULL;
+static size_t  n_queued    = 0;
+
+// Jobs with processes still running
+static size_t n_running_jobs = 0;
+
+// While builtin threads run, forking could copy locks they hold, so queued
+// jobs only start once the holds are released
+static size_t n_dispatch_holds = 0;
+
+// ========== Pid Index ==========
+
+// Open addressing hash table from pid to the job and its slot in pids.
+// A pid of 0 marks an empty entry.
+typedef struct {
+    pid_t  pid;
+    size_t i_job;
+    size_t i_pid;
+} PidEntry;
+
+static const size_t INIT_PID_INDEX_CAPACITY = 64;  // must be a power of 2
+
+static PidEntry* pid_index          = NULL;
+static size_t    pid_index_len      = 0;
+static size_t    pid_index_capacity = 0;
+
+// ========== SIGCHLD ==========
+
+static int sigchld_fd = -1;
+
+// Jobs are children of the shell, which forked processes cannot wait for
+static pid_t shell_pid = -1;
+
+// ========== Notices ==========
+
+// The stdout of the shell when it started, where job notices go even while a
+// command substitution or a builtin has redirected stdout
+static int notice_fd = -1;
+
+static void display_notice(const char* const fmt, ...) {
+    fflush(stdout);
+
+    va_list args;
+    va_start(args, fmt);
+    vdprintf(notice_fd != -1 ? notice_fd : STDOUT_FILENO, fmt, args);
+    va_end(args);
+}
+
 void init_background() {
     jobs          = malloc(INIT_JOBS_CAPACITY * sizeof(JobInfo));
+    jobs_len      = 0;
     jobs_capacity = INIT_JOBS_CAPACITY;
+
+    free_slots      = malloc(INIT_JOBS_CAPACITY * sizeof(size_t));
+    n_free_slots    = 0;
+    finished_jobs   = malloc(INIT_JOBS_CAPACITY * sizeof(size_t));
+    n_finished_jobs = 0;
+    queued_jobs     = malloc(INIT_JOBS_CAPACITY * sizeof(size_t));
+    n_queued        = 0;
+    n_running_jobs  = 0;
+
+    pid_index          = calloc(INIT_PID_INDEX_CAPACITY, sizeof(PidEntry));
+    pid_index_len      = 0;
+    pid_index_capacity = INIT_PID_INDEX_CAPACITY;
+
+    shell_pid = getpid();
+    notice_fd = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0);
+
+    // Receive SIGCHLD through a fd instead of interrupting the shell
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    sigchld_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
 }
 
 void free_background() {
+    // queued jobs never start
+    n_queued = 0;
     check_background_status(true);
 
     for (size_t i = 0; i < jobs_len; i++) {
         // kill all non-terminated processes
-        if (jobs[i].n_running == 0) continue;
+        if (jobs[i].pids == NULL) continue;
         for (size_t j = 0; j < jobs[i].n_pid; j++) {
             if (jobs[i].pids[j] != -1) {
                 kill(jobs[i].pids[j], SIGKILL);
@@ -35,112 +130,457 @@ void free_background() {
                             jobs[i].pids[j]);
             }
         }
+        if (jobs[i].spec != NULL) jobs[i].launcher->release(jobs[i].spec);
         free(jobs[i].pids);
         free(jobs[i].cmd);
     }
     free(jobs);
+    free(free_slots);
+    free(finished_jobs);
+    free(queued_jobs);
+    free(pid_index);
+
+    close(sigchld_fd);
+    sigchld_fd = -1;
+    if (notice_fd != -1) close(notice_fd);
+    notice_fd = -1;
 }
 
-static int push_job(pid_t* const pids, const size_t n_proc,
-                    const char* const cmd) {
-    assert(jobs_len <= jobs_capacity);
+static int pidfd_open(const pid_t pid) {
+    return syscall(SYS_pidfd_open, pid, 0);
+}
 
-    if (jobs_len == jobs_capacity) {
-        jobs_capacity *= 2;
-        jobs           = realloc(jobs, jobs_capacity * sizeof(JobInfo));
+// ========== Pid Index ==========
+
+/**
+ * @return The preferred slot of pid in an index of the given capacity.
+ */
+static size_t pid_home(const pid_t pid, const size_t capacity) {
+    // Fibonacci hashing spreads consecutive pids
+    return ((uint64_t)pid * 0x9e3779b97f4a7c15ULL >> 32) & (capacity - 1);
+}
+
+static PidEntry* find_pid(PidEntry* const index, const size_t capacity,
+                          const pid_t pid) {
+    const size_t mask = capacity - 1;
+    for (size_t i = pid_home(pid, capacity);; i = (i + 1) & mask) {
+        if (index[i].pid == pid || index[i].pid == 0) return &index[i];
     }
+}
 
-    pid_t* const owned_pids = malloc((n_proc + 1) * sizeof(pid_t));
-    memcpy(owned_pids, pids, n_proc * sizeof(pid_t));
-    owned_pids[n_proc] = -1;  // pids is terminated by -1
+static void insert_pid(const pid_t pid, const size_t i_job,
+                       const size_t i_pid) {
+    // keep load factor below 1/2
+    if ((pid_index_len + 1) * 2 > pid_index_capacity) {
+        const size_t    new_capacity = pid_index_capacity * 2;
+        PidEntry* const new_index = calloc(new_capacity, sizeof(PidEntry));
+        for (size_t i = 0; i < pid_index_capacity; i++) {
+            if (pid_index[i].pid == 0) continue;
+            *find_pid(new_index, new_capacity, pid_index[i].pid) =
+                pid_index[i];
+        }
+        free(pid_index);
+        pid_index          = new_index;
+        pid_index_capacity = new_capacity;
+    }
 
-    jobs[jobs_len] = (JobInfo){.pids      = owned_pids,
-                               .n_pid     = n_proc,
-                               .n_running = n_proc,
-                               .cmd       = strdup(cmd)};
+    *find_pid(pid_index, pid_index_capacity, pid) =
+        (PidEntry){.pid = pid, .i_job = i_job, .i_pid = i_pid};
+    pid_index_len++;
+}
 
-    return ++jobs_len;  // return index + 1
+/**
+ * @brief Remove an entry, shifting back the entries after it in its probe
+ * sequence so that lookups need no tombstones.
+ */
+static void remove_pid(PidEntry* entry) {
+    const size_t mask = pid_index_capacity - 1;
+
+    size_t hole = entry - pid_index;
+    for (size_t i = (hole + 1) & mask; pid_index[i].pid != 0;
+         i        = (i + 1) & mask) {
+        const size_t home = pid_home(pid_index[i].pid, pid_index_capacity);
+
+        // move the entry into the hole unless its home lies in (hole, i]
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            pid_index[hole] = pid_index[i];
+            hole            = i;
+        }
+    }
+    pid_index[hole].pid = 0;
+    pid_index_len--;
 }
 
+// ========== Job List ==========
+
 /**
- * @brief Attempt to pop a job from the list.
+ * @brief Add a job whose processes have started, or will start when it
+ * leaves the queue.
  *
- * @param [in] pid The pid of the process.
- * @param [out] cmd The command string of the job.
- * @return The index of the job in the list (starts from 1) if all processes of
- * the job have finished, or -1 otherwise.
+ * @param [in] pids The pids of the processes, or NULL for a queued job.
+ * @return The job number.
  */
-static int pop_job(const pid_t pid, char* const cmd) {
-    size_t i_job;
-    for (i_job = 0; i_job < jobs_len; i_job++) {
-        if (jobs[i_job].n_running == 0) continue;
+static size_t push_job(const pid_t* const pids, const size_t n_proc,
+                       const char* const cmd) {
+    assert(jobs_len <= jobs_capacity);
 
-        const JobInfo* const job = &jobs[i_job];
+    size_t i_job;
+    if (n_free_slots > 0) {
+        i_job = free_slots[--n_free_slots];
 
-        size_t i_pid;
-        for (i_pid = 0; i_pid < job->n_pid; i_pid++) {
-            if (job->pids[i_pid] == pid) {  // found pid
-                jobs[i_job].pids[i_pid] = -1;
-                jobs[i_job].n_running--;
-                break;
-            }
+    } else {
+        if (jobs_len == jobs_capacity) {
+            jobs_capacity *= 2;
+            jobs = realloc(jobs, jobs_capacity * sizeof(JobInfo));
+            free_slots =
+                realloc(free_slots, jobs_capacity * sizeof(size_t));
+            finished_jobs =
+                realloc(finished_jobs, jobs_capacity * sizeof(size_t));
+            queued_jobs =
+                realloc(queued_jobs, jobs_capacity * sizeof(size_t));
         }
-        if (i_pid < job->n_pid) break;
+        i_job = jobs_len++;
     }
-    if (i_job == jobs_len) return -1;  // not found
 
-    if (jobs[i_job].n_running > 0) return -1;  // not finished
-
-    // write output
-    strcpy(cmd, jobs[i_job].cmd);
+    // pids is terminated by -1
+    pid_t* const owned_pids = malloc((n_proc + 1) * sizeof(pid_t));
+    for (size_t i = 0; i <= n_proc; i++) owned_pids[i] = -1;
+
+    jobs[i_job] = (JobInfo){.id        = i_job + 1,
+                            .pids      = owned_pids,
+                            .n_pid     = n_proc,
+                            .n_running = 0,
+                            .cmd       = strdup(cmd),
+                            .wstatus   = -1};
+
+    if (pids != NULL) {
+        memcpy(owned_pids, pids, n_proc * sizeof(pid_t));
+        jobs[i_job].n_running = n_proc;
+        for (size_t i = 0; i < n_proc; i++) insert_pid(pids[i], i_job, i);
+        n_running_jobs++;
+    }
 
-    // free resources
-    free(jobs[i_job].pids);
-    free(jobs[i_job].cmd);
-    jobs[i_job].pids = NULL;
-    jobs[i_job].cmd  = NULL;
+    return i_job + 1;  // return index + 1
+}
 
-    // shrink the list
-    while (jobs_len > 0 && jobs[jobs_len - 1].n_running == 0) {
+/**
+ * @brief Release the slot of a finished job.
+ */
+static void free_job(const size_t i_job) {
+    JobInfo* const job = &jobs[i_job];
+    assert(job->n_running == 0);
+
+    if (job->spec != NULL) job->launcher->release(job->spec);
+    job->spec = NULL;
+    free(job->pids);
+    free(job->cmd);
+    job->pids = NULL;
+    job->cmd  = NULL;
+
+    // shrink the list if possible, otherwise keep the slot for reuse
+    if (i_job == jobs_len - 1) {
         jobs_len--;
-        assert(jobs[jobs_len].pids == NULL);
-        assert(jobs[jobs_len].cmd == NULL);
+    } else {
+        free_slots[n_free_slots++] = i_job;
     }
+}
+
+// ========== Queue ==========
 
-    if (jobs_len == 0 && jobs_capacity > INIT_JOBS_CAPACITY) {
-        free_background();
-        init_background();
+/**
+ * @return The maximum number of running jobs, or 0 if unlimited.
+ */
+static size_t max_jobs() {
+    const Variable* const var =
+        find_variable(MAX_JOBS_VAR, strlen(MAX_JOBS_VAR));
+    if (var == NULL || var->value_len == 0) return 0;
+
+    char*               end;
+    const unsigned long n = strtoul(var->value, &end, 10);
+    if (*end != '\0' || var->value[0] == '-') {
+        display_error("ERROR: Invalid %s: %s\n", MAX_JOBS_VAR, var->value);
+        return 0;
     }
+    return n;
+}
+
+static bool below_max_jobs() {
+    const size_t max = max_jobs();
+    return max == 0 || n_running_jobs < max;
+}
+
+static void remove_queued(const size_t i_job) {
+    size_t i = 0;
+    while (queued_jobs[i] != i_job) i++;
+    memmove(queued_jobs + i, queued_jobs + i + 1,
+            (--n_queued - i) * sizeof(size_t));
+}
+
+/**
+ * @brief Start queued jobs while fewer than the maximum are running.
+ */
+static void dispatch_jobs() {
+    if (n_dispatch_holds > 0) return;
+
+    while (n_queued > 0 && below_max_jobs()) {
+        const size_t   i_job = queued_jobs[0];
+        JobInfo* const job   = &jobs[i_job];
+        remove_queued(i_job);
+
+        display_notice("[%zu]  Started\t%s\n", job->id, job->cmd);
 
-    return i_job + 1;
+        void* const spec = job->spec;
+        job->spec        = NULL;
+
+        const size_t n_started = job->launcher->start(spec, job->pids);
+        job->n_pid             = n_started;
+        job->n_running         = n_started;
+        job->pids[n_started]   = -1;
+        for (size_t i = 0; i < n_started; i++) {
+            insert_pid(job->pids[i], i_job, i);
+        }
+
+        if (n_started == 0) {
+            finished_jobs[n_finished_jobs++] = i_job;
+            continue;
+        }
+        n_running_jobs++;
+    }
 }
 
 // ========== Public Interface ==========
 
+bool can_start_job() { return n_queued == 0 && below_max_jobs(); }
+
+void hold_job_dispatch() { n_dispatch_holds++; }
+
+void release_job_dispatch() {
+    assert(n_dispatch_holds > 0);
+    n_dispatch_holds--;
+    dispatch_jobs();
+}
+
 void add_background_job(pid_t* const pids, const size_t n_proc,
                         const char* const cmd) {
     const int index = push_job(pids, n_proc, cmd);
 
-    display_message("[%d]\t%d\n", index, pids[n_proc - 1]);
+    display_notice("[%d]\t%d\n", index, pids[n_proc - 1]);
 }
 
-void check_background_status(bool slience) {
+void queue_background_job(const size_t n_proc, const char* const cmd,
+                          const JobLauncher* const launcher,
+                          void* const spec) {
+    const size_t   id  = push_job(NULL, n_proc, cmd);
+    JobInfo* const job = &jobs[id - 1];
+    job->launcher      = launcher;
+    job->spec          = spec;
+    queued_jobs[n_queued++] = id - 1;
+
+    display_notice("[%zu]  Queued\t%s\n", id, cmd);
+}
+
+int get_sigchld_fd() { return sigchld_fd; }
+
+void reap_child(const pid_t pid, const int wstatus) {
+    PidEntry* const entry = find_pid(pid_index, pid_index_capacity, pid);
+    if (entry->pid == 0) return;  // not a job process
+
+    const size_t   i_job = entry->i_job;
+    JobInfo* const job   = &jobs[i_job];
+
+    if (entry->i_pid == job->n_pid - 1) job->wstatus = wstatus;
+    job->pids[entry->i_pid] = -1;
+    job->n_running--;
+    remove_pid(entry);
+
+    if (job->n_running == 0) {
+        finished_jobs[n_finished_jobs++] = i_job;
+        n_running_jobs--;
+        dispatch_jobs();
+    }
+}
+
+/**
+ * @brief Reap the exited processes after SIGCHLD.
+ *
+ * @return Whether SIGCHLD has been received.
+ */
+static bool reap_jobs() {
+    // drain pending SIGCHLD, and only wait if there were any
+    struct signalfd_siginfo info;
+    bool                    sigchld = false;
+    while (read(sigchld_fd, &info, sizeof(info)) == sizeof(info)) {
+        sigchld = true;
+    }
+
+    if (sigchld) {
+        int   wstatus;
+        pid_t pid;
+        while ((pid = waitpid(-1, &wstatus, WNOHANG)) > 0) {
+            reap_child(pid, wstatus);
+        }
+    }
+    return sigchld;
+}
+
+size_t check_background_status(const bool slience) {
+    reap_jobs();
+
+    // MYSH_MAX_JOBS may have been raised
+    dispatch_jobs();
+
+    const size_t n_reported = n_finished_jobs;
+    for (size_t i = 0; i < n_finished_jobs; i++) {
+        const size_t i_job = finished_jobs[i];
+        if (!slience) {
+            display_notice("[%zu]+  Done\t%s\n", i_job + 1, jobs[i_job].cmd);
+        }
+        free_job(i_job);
+    }
+    n_finished_jobs = 0;
+
+    // shrink past free slots at the end of the list, and forget them
+    while (jobs_len > 0 && jobs[jobs_len - 1].pids == NULL) jobs_len--;
+
+    size_t n_kept = 0;
+    for (size_t i = 0; i < n_free_slots; i++) {
+        if (free_slots[i] < jobs_len) free_slots[n_kept++] = free_slots[i];
+    }
+    n_free_slots = n_kept;
+
+    return n_reported;
+}
+
+/**
+ * @brief Close the pidfd of a reaped process, so that poll ignores it.
+ */
+static void close_pidfd(struct pollfd* const fd) {
+    if (fd->fd != -1) close(fd->fd);
+    fd->fd = -1;
+}
+
+/**
+ * @brief Reap all exited processes. Foreground processes among them are
+ * marked as exited, with their pidfds in fds closed, and the others are passed
+ * to the job table.
+ */
+static void reap_all(pid_t* const pids, struct pollfd* const fds,
+                     const size_t n_pid, int* const statuses,
+                     size_t* const n_exited) {
+    int   status;
     pid_t pid;
-    do {
-        int status;
-        pid = waitpid(-1, &status, WNOHANG);
-        if (pid == -1) return;
-
-        // if a job process has finished
-        if (pid > 0 && (WIFEXITED(status) || WIFSIGNALED(status))) {
-            char      cmd[MAX_STR_LEN];
-            const int index = pop_job(pid, cmd);
-            if (index == -1) continue;  // not a job process
-            if (!slience) {
-                display_message("[%d]+  Done\t%s\n", index, cmd);
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        size_t i = 0;
+        while (i < n_pid && pids[i] != pid) i++;
+
+        if (i == n_pid) {
+            reap_child(pid, status);
+        } else {
+            pids[i]     = -1;
+            statuses[i] = status;
+            close_pidfd(&fds[i]);
+            (*n_exited)++;
+        }
+    }
+}
+
+int wait_children(const pid_t* const pids, const size_t n_pid) {
+    // one pidfd per process, and the SIGCHLD fd last
+    struct pollfd* const fds       = malloc((n_pid + 1) * sizeof(*fds));
+    pid_t* const         remaining = malloc(n_pid * sizeof(pid_t));
+    int* const           statuses  = malloc(n_pid * sizeof(int));
+
+    for (size_t i = 0; i < n_pid; i++) {
+        // a process without pidfd is still reaped after SIGCHLD
+        fds[i]       = (struct pollfd){.fd     = pidfd_open(pids[i]),
+                                       .events = POLLIN};
+        remaining[i] = pids[i];
+        statuses[i]  = -1;
+    }
+    fds[n_pid] = (struct pollfd){.fd = sigchld_fd, .events = POLLIN};
+
+    size_t n_exited = 0;
+    while (n_exited < n_pid) {
+        if (poll(fds, n_pid + 1, -1) == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (size_t i = 0; i < n_pid; i++) {
+            // waitpid(-1) would reap any child
+            if (!(fds[i].revents & POLLIN) || remaining[i] == -1) continue;
+
+            if (waitpid(remaining[i], &statuses[i], WNOHANG) > 0) {
+                remaining[i] = -1;
+                n_exited++;
+            }
+            close_pidfd(&fds[i]);
+        }
+
+        if (fds[n_pid].revents & POLLIN) {
+            struct signalfd_siginfo info;
+            while (read(sigchld_fd, &info, sizeof(info)) == sizeof(info));
+            reap_all(remaining, fds, n_pid, statuses, &n_exited);
+        }
+    }
+
+    for (size_t i = 0; i < n_pid; i++) close_pidfd(&fds[i]);
+    const int status = n_pid > 0 ? statuses[n_pid - 1] : -1;
+
+    free(fds);
+    free(remaining);
+    free(statuses);
+
+    return status;
+}
+
+int wait_child(const pid_t pid) { return wait_children(&pid, 1); }
+
+int open_child_pidfd(const pid_t pid) { return pidfd_open(pid); }
+
+size_t wait_any_child(pid_t* const pids, int* const pidfds,
+                      int* const statuses, const size_t n_pid) {
+    // one pidfd per running process, and the SIGCHLD fd last
+    struct pollfd* const fds = malloc((n_pid + 1) * sizeof(*fds));
+    for (size_t i = 0; i < n_pid; i++) {
+        fds[i] = (struct pollfd){.fd = pidfds[i], .events = POLLIN};
+    }
+    fds[n_pid] = (struct pollfd){.fd = sigchld_fd, .events = POLLIN};
+
+    size_t n_exited = 0;
+    while (n_exited == 0) {
+        // a signal ends the wait, so that the caller can handle SIGINT
+        if (poll(fds, n_pid + 1, -1) == -1) break;
+
+        for (size_t i = 0; i < n_pid; i++) {
+            // waitpid(-1) would reap any child
+            if (!(fds[i].revents & POLLIN) || pids[i] == -1) continue;
+
+            if (waitpid(pids[i], &statuses[i], WNOHANG) > 0) {
+                pids[i] = -1;
+                n_exited++;
             }
+            close_pidfd(&fds[i]);
         }
-    } while (pid);
+
+        if (fds[n_pid].revents & POLLIN) {
+            struct signalfd_siginfo info;
+            while (read(sigchld_fd, &info, sizeof(info)) == sizeof(info));
+            reap_all(pids, fds, n_pid, statuses, &n_exited);
+        }
+    }
+
+    // the pidfds of the processes still running stay open
+    for (size_t i = 0; i < n_pid; i++) pidfds[i] = fds[i].fd;
+    free(fds);
+
+    return n_exited;
+}
+
+int exit_status(const int wstatus) {
+    if (wstatus == -1) return EXIT_FAILURE;
+    if (WIFSIGNALED(wstatus)) return 128 + WTERMSIG(wstatus);
+    return WEXITSTATUS(wstatus);
 }
 
 const JobInfo* read_job(const JobInfo* const prev) {
@@ -152,15 +592,84 @@ const JobInfo* read_job(const JobInfo* const prev) {
     }
 
     const JobInfo* const end = jobs + jobs_len;
-    // get the next valid job
-    while (curr < end && curr->n_running == 0) {
+    // get the next running or queued job
+    while (curr < end && curr->n_running == 0 && curr->spec == NULL) {
         curr++;
     }
     if (curr == end) return NULL;
 
-    assert(curr->n_running > 0);
     assert(curr->pids != NULL);
     assert(curr->cmd != NULL);
 
     return curr;
 }
+
+/**
+ * @return The job with the given number, which may have finished, or NULL.
+ */
+static JobInfo* find_slot(const size_t id) {
+    if (id == 0 || id > jobs_len || jobs[id - 1].pids == NULL) return NULL;
+    return &jobs[id - 1];
+}
+
+static bool is_active(const JobInfo* const job) {
+    return job->n_running > 0 || job->spec != NULL;
+}
+
+const JobInfo* find_job(const size_t id) {
+    const JobInfo* const job = find_slot(id);
+    return job != NULL && is_active(job) ? job : NULL;
+}
+
+/**
+ * @brief Sleep until SIGCHLD, and reap the exited processes.
+ *
+ * @return false if interrupted by a signal.
+ */
+static bool wait_sigchld() {
+    struct pollfd fd = {.fd = sigchld_fd, .events = POLLIN};
+    if (poll(&fd, 1, -1) == -1) return false;
+
+    reap_jobs();
+    return true;
+}
+
+int wait_job(const size_t id) {
+    if (getpid() != shell_pid) return -1;
+
+    while (true) {
+        // finished jobs are kept until they are reported
+        const JobInfo* const job = find_slot(id);
+        if (job == NULL) return -1;
+        if (!is_active(job)) return exit_status(job->wstatus);
+
+        if (!wait_sigchld()) return 128 + SIGINT;
+    }
+}
+
+int wait_all_jobs() {
+    if (getpid() != shell_pid) return EXIT_SUCCESS;
+
+    while (read_job(NULL) != NULL) {
+        if (!wait_sigchld()) return 128 + SIGINT;
+    }
+    return EXIT_SUCCESS;
+}
+
+bool signal_job(const size_t id, const int sig) {
+    JobInfo* const job = (JobInfo*)find_job(id);
+    if (job == NULL) return false;
+
+    if (job->spec != NULL) {
+        // a queued job has no processes yet, and never starts
+        display_notice("[%zu]  Killed\t%s\n", job->id, job->cmd);
+        remove_queued(id - 1);
+        free_job(id - 1);
+        return true;
+    }
+
+    for (size_t i = 0; i < job->n_pid; i++) {
+        if (job->pids[i] != -1) kill(job->pids[i], sig);
+    }
+    return true;
+}
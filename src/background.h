@@ -4,17 +4,62 @@
 #include <stdbool.h>
 #include <sys/types.h>
 
+/**
+ * Functions of the executor which start a queued job.
+ */
 typedef struct {
+    /**
+     * @brief Start the processes of a job, and release its spec.
+     * @param [out] pids Receives the pids, at most one per command.
+     * @return The number of processes started.
+     */
+    size_t (*start)(void* spec, pid_t* pids);
+
+    /**
+     * @brief Release the spec of a job which is removed before it starts.
+     */
+    void (*release)(void* spec);
+} JobLauncher;
+
+typedef struct {
+    size_t id;  // the job number
     pid_t* pids;
     size_t n_pid;
     size_t n_running;
     char*  cmd;
+    int    wstatus;  // of the last process, once the job has finished
+
+    // A queued job waits for a running job to finish before it starts
+    const JobLauncher* launcher;
+    void*              spec;  // NULL once started
 } JobInfo;
 
 void init_background();
 
 void free_background();
 
+/**
+ * @brief Check whether a new background job may start now.
+ *
+ * The number of running jobs is limited by the MYSH_MAX_JOBS variable, which
+ * may come from the environment. It is unlimited if the variable is unset or
+ * 0. Jobs start in order, so none may start while others are queued.
+ */
+bool can_start_job();
+
+/**
+ * @brief Keep queued jobs from starting while builtin threads of the shell
+ * run, since forking a multithreaded process may copy a lock another thread
+ * holds. Jobs whose turn comes meanwhile start on release.
+ */
+void hold_job_dispatch();
+
+/**
+ * @brief Release a hold of hold_job_dispatch, and start the queued jobs whose
+ * turn has come once no hold remains.
+ */
+void release_job_dispatch();
+
 /**
  * @prarm [in] An array of pids of the processes.
  * @param [in] n_proc The number of processes.
@@ -22,8 +67,135 @@ void free_background();
  */
 void add_background_job(pid_t* pids, size_t n_proc, const char* cmd);
 
-void check_background_status(bool slience);
+/**
+ * @brief Add a job which starts when a running job finishes and a slot is
+ * free, after the jobs queued before it.
+ *
+ * @param [in] n_proc The number of commands of the job.
+ * @param [in] cmd The command string.
+ * @param [in] launcher Starts the job.
+ * @param [in] spec Passed to the launcher.
+ */
+void queue_background_job(size_t n_proc, const char* cmd,
+                          const JobLauncher* launcher, void* spec);
+
+/**
+ * @return A fd which becomes readable when a child process has exited.
+ */
+int get_sigchld_fd();
+
+/**
+ * @brief Record that a process has been reaped, if it belongs to a job.
+ *
+ * Finished jobs are reported by the next check_background_status, and queued
+ * jobs are started in their place unless the dispatch is held.
+ *
+ * @param [in] pid The pid of the process.
+ * @param [in] wstatus Its wait status.
+ */
+void reap_child(pid_t pid, int wstatus);
+
+/**
+ * @brief Reap exited job processes and report the finished jobs.
+ *
+ * Processes are only waited for after SIGCHLD, so the check is cheap when no
+ * child has exited.
+ *
+ * @param [in] slience Whether not to print the finished jobs.
+ * @return The number of finished jobs.
+ */
+size_t check_background_status(bool slience);
+
+/**
+ * @brief Wait for a process to terminate. Job processes exiting meanwhile are
+ * reaped, so that they do not remain zombies.
+ *
+ * @return The wait status of the process, or -1 on error.
+ */
+int wait_child(pid_t pid);
+
+/**
+ * @brief Open a pidfd for a child process, for wait_any_child.
+ *
+ * @return The pidfd, or -1 if it cannot be opened, in which case the process
+ * is still reaped after SIGCHLD.
+ */
+int open_child_pidfd(pid_t pid);
+
+/**
+ * @brief Wait until at least one of the given processes terminates.
+ *
+ * Like wait_children, the processes are waited for through their pidfds, and
+ * job processes exiting meanwhile are passed to the job table. The pidfds
+ * belong to the caller, so that repeated waits on the same processes do not
+ * open them again.
+ *
+ * @param [in,out] pids The pids of the processes. Entries of -1 are skipped,
+ * and those of terminated processes are set to -1.
+ * @param [in,out] pidfds The pidfds of the processes from open_child_pidfd, or
+ * -1. Those of terminated processes are closed and set to -1.
+ * @param [out] statuses Receives the wait statuses of terminated processes.
+ * @param [in] n_pid The number of entries.
+ * @return The number of processes which have terminated, or 0 if the wait was
+ * interrupted by a signal.
+ */
+size_t wait_any_child(pid_t* pids, int* pidfds, int* statuses, size_t n_pid);
+
+/**
+ * @brief Wait for all processes of a foreground pipeline to terminate.
+ *
+ * Only the given processes are waited for through their pidfds, so the wait
+ * does not depend on background jobs. Job processes exiting meanwhile are
+ * passed to the job table.
+ *
+ * @param [in] pids The pids of the processes.
+ * @param [in] n_pid The number of processes.
+ * @return The wait status of the last process, or -1 on error.
+ */
+int wait_children(const pid_t* pids, size_t n_pid);
+
+/**
+ * @brief Convert a wait status to an exit status, as in $?.
+ *
+ * @return The exit code of the process, 128 plus the number of the signal
+ * which terminated it, or 1 if the wait failed.
+ */
+int exit_status(int wstatus);
 
+/**
+ * @brief Iterate over the running and queued jobs.
+ *
+ * @param [in] prev The previous job, or NULL to get the first job.
+ * @return The next job, or NULL if there are no more jobs.
+ */
 const JobInfo* read_job(const JobInfo* prev);
 
+/**
+ * @return The running or queued job with the given number, or NULL.
+ */
+const JobInfo* find_job(size_t id);
+
+/**
+ * @brief Wait for a job to finish. Queued jobs start meanwhile.
+ *
+ * @return The exit status of the last process of the job, -1 if there is no
+ * such job, or 128 plus SIGINT if the wait is interrupted by a signal.
+ */
+int wait_job(size_t id);
+
+/**
+ * @brief Wait for all running and queued jobs to finish.
+ *
+ * @return 0, or 128 plus SIGINT if the wait is interrupted by a signal.
+ */
+int wait_all_jobs();
+
+/**
+ * @brief Send a signal to the processes of a running job, or remove a queued
+ * job.
+ *
+ * @return false if there is no such job.
+ */
+bool signal_job(size_t id, int sig);
+
 #endif
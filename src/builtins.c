@@ -2,18 +2,67 @@
 
 #include <string.h>
 
+#include "builtins/cat.h"
 #include "builtins/cd.h"
+#include "builtins/echo.h"
+#include "builtins/export.h"
+#include "builtins/hash.h"
+#include "builtins/jobs.h"
+#include "builtins/parallel.h"
+#include "builtins/parsecache.h"
+#include "builtins/printf.h"
+#include "builtins/pwd.h"
+#include "builtins/tee.h"
+#include "builtins/test.h"
+#include "builtins/true.h"
+#include "builtins/wc.h"
 
-static const Builtin BUILTINS[] = {
-    {"cd", bn_cd, true},  // foreground
+// Perfect hash of a builtin name from its length and first and last
+// characters. It is evaluated at compile time to place the builtins, and a
+// collision fails the build with -Woverride-init.
+#define BUILTIN_SLOTS 64
+#define BUILTIN_SLOT(len, first, last) \
+    (((len) * 2 + (first) * 6 + (last)) & (BUILTIN_SLOTS - 1))
+
+#define BUILTIN(name, first, last, fn, foreground, threaded) \
+    [BUILTIN_SLOT(sizeof(name) - 1, first, last)] = {     \
+        name, fn, foreground, threaded}
+
+// Builtins which run in the shell process avoid forking. Builtins changing
+// the state of the shell must not run on a thread, since a pipeline stage
+// should not affect the shell.
+static const Builtin BUILTINS[BUILTIN_SLOTS] = {
+    BUILTIN("cd", 'c', 'd', bn_cd, true, false),
+    BUILTIN("hash", 'h', 'h', bn_hash, true, false),
+    BUILTIN("parsecache", 'p', 'e', bn_parsecache, true, false),
+    BUILTIN("export", 'e', 't', bn_export, true, false),
+    BUILTIN("unset", 'u', 't', bn_unset, true, false),
+    BUILTIN("local", 'l', 'l', bn_local, true, false),
+    BUILTIN("parallel", 'p', 'l', bn_parallel, true, false),
+    BUILTIN("jobs", 'j', 's', bn_jobs, true, false),
+    BUILTIN("wait", 'w', 't', bn_wait, true, false),
+    BUILTIN("kill", 'k', 'l', bn_kill, true, false),
+    BUILTIN("echo", 'e', 'o', bn_echo, true, true),
+    BUILTIN("printf", 'p', 'f', bn_printf, true, true),
+    BUILTIN("true", 't', 'e', bn_true, true, true),
+    BUILTIN("false", 'f', 'e', bn_false, true, true),
+    BUILTIN("cat", 'c', 't', bn_cat, true, true),
+    BUILTIN("wc", 'w', 'c', bn_wc, true, true),
+    BUILTIN("pwd", 'p', 'd', bn_pwd, true, true),
+    BUILTIN("test", 't', 't', bn_test, true, true),
+    BUILTIN("[", '[', '[', bn_bracket, true, true),
+    BUILTIN("tee", 't', 'e', bn_tee, true, true),
 };
-static const size_t BUILTINS_COUNT = sizeof(BUILTINS) / sizeof(Builtin);
 
 const Builtin* check_builtin(const char* const cmd) {
-    for (size_t i = 0; i < BUILTINS_COUNT; i++) {
-        if (strcmp(cmd, BUILTINS[i].name) == 0) {
-            return &BUILTINS[i];
-        }
+    const size_t len = strlen(cmd);
+    if (len == 0) return NULL;
+
+    const Builtin* const builtin =
+        &BUILTINS[BUILTIN_SLOT(len, (unsigned char)cmd[0],
+                               (unsigned char)cmd[len - 1])];
+    if (builtin->name == NULL || strcmp(cmd, builtin->name) != 0) {
+        return NULL;
     }
-    return NULL;
+    return builtin;
 }
@@ -1,21 +1,33 @@
 #ifndef __BUILTINS_H__
 #define __BUILTINS_H__
 
+#include <stdio.h>
 #include <unistd.h>
 
 #include "types.h"
 
+/**
+ * Standard input and output of a builtin. Builtins use these instead of the
+ * process-wide stdin and stdout, since they may run on a thread.
+ */
+typedef struct {
+    int   in_fd;
+    FILE *out;
+} BuiltinIO;
+
 /**
  * @brief Type for builtin handling functions
  * @param [in] tokens Array of tokens
+ * @param [in] io Input and output of the builtin
  * @return >=0 on success and -1 on error
  */
-typedef RetVal (*builtin_fn)(size_t, char *const *);
+typedef RetVal (*builtin_fn)(size_t, char *const *, const BuiltinIO *);
 
 typedef struct {
     const char *name;
     builtin_fn  fn;
     const bool  foreground;
+    const bool  threaded;  // may run on a thread as a pipeline stage
 } Builtin;
 
 /**
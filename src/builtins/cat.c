@@ -0,0 +1,56 @@
+#include "cat.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../io_helpers.h"
+#include "../utils/copy.h"
+
+/**
+ * @brief Copy everything from in_fd to out_fd.
+ */
+static RetVal cat_fd(const int in_fd, const int out_fd,
+                     const char *const name) {
+    if (copy_fd(in_fd, out_fd) == -1) {
+        // the reader has gone, which ends cat quietly like SIGPIPE would
+        if (errno == EPIPE) return RETVAL_FALSE;
+
+        // also interrupted by SIGINT
+        display_error("ERROR: cat: Cannot copy: %s\n", name);
+        return RETVAL_FAILURE;
+    }
+    return RETVAL_SUCCESS;
+}
+
+RetVal bn_cat(const size_t argc, char *const *const argv,
+              const BuiltinIO *const io) {
+    // bypass stdio, so flush what is buffered first
+    fflush(io->out);
+    const int out_fd = fileno(io->out);
+
+    if (argc == 1) return cat_fd(io->in_fd, out_fd, "-");
+
+    RetVal retval = RETVAL_SUCCESS;
+    for (size_t i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-") == 0) {
+            if (FAILED(cat_fd(io->in_fd, out_fd, "-"))) {
+                retval = RETVAL_FAILURE;
+            }
+            continue;
+        }
+
+        const int fd = open(argv[i], O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            display_error("ERROR: cat: Cannot open file: %s\n", argv[i]);
+            retval = RETVAL_FAILURE;
+            continue;
+        }
+        if (FAILED(cat_fd(fd, out_fd, argv[i]))) retval = RETVAL_FAILURE;
+        close(fd);
+    }
+
+    return retval;
+}
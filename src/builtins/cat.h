@@ -0,0 +1,8 @@
+#ifndef __BUILTINS_CAT_H__
+#define __BUILTINS_CAT_H__
+
+#include "../builtins.h"
+
+RetVal bn_cat(size_t argc, char *const *argv, const BuiltinIO *io);
+
+#endif
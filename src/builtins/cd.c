@@ -1,10 +1,9 @@
-#include "cd.h"
-
-#include <stddef.h>
-
 #define _GNU_SOURCE
 
+#include "cd.h"
+
 #include <assert.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -12,7 +11,6 @@
 #include "../io_helpers.h"
 #include "../utils/string.h"
 
-#define MAX_PATH           (MAX_STR_LEN * 2)
 #define PATH_DELIM         '/'
 #define EXPANDED_TRIP_DOTS "../../"
 #define EXPANDED_QUAD_DOTS "../../../"
@@ -48,8 +46,11 @@ static RetVal parse_cd_args(CdArgs *args, const size_t argc,
  * @warning The caller is responsible for freeing the returned string.
  */
 char *expand_path(const char *path) {
-    char *expanded      = malloc(MAX_PATH + 1);
-    char *expanded_tail = mepcat(expanded, MAX_PATH, NULL, 0);
+    // "...." expands to "../../../", so a path grows at most 9/4 times
+    const size_t max_path      = strlen(path) * 9 / 4 + 1;
+    char        *expanded      = malloc(max_path + 1);
+    char *const  expanded_end  = expanded + max_path;
+    char        *expanded_tail = expanded;
 
     const char *part_begin = path;
     const char *part_end;
@@ -61,20 +62,22 @@ char *expand_path(const char *path) {
             strncmp(part_begin, "...\0", 4) == 0) {
             // expand triple dots
             expanded_tail =
-                mepcat(NULL, 0, EXPANDED_TRIP_DOTS, strlen(EXPANDED_TRIP_DOTS));
+                mepcat(expanded_tail, expanded_end, EXPANDED_TRIP_DOTS,
+                       strlen(EXPANDED_TRIP_DOTS));
 
         } else if (strncmp(part_begin, "..../", 5) == 0 ||
                    strncmp(part_begin, "....\0", 5) == 0) {
             // expand quadruple dots
             expanded_tail =
-                mepcat(NULL, 0, EXPANDED_QUAD_DOTS, strlen(EXPANDED_QUAD_DOTS));
+                mepcat(expanded_tail, expanded_end, EXPANDED_QUAD_DOTS,
+                       strlen(EXPANDED_QUAD_DOTS));
 
         } else {
-            expanded_tail =
-                mepcat(NULL, 0, part_begin, part_end + 1 - part_begin);
+            expanded_tail = mepcat(expanded_tail, expanded_end, part_begin,
+                                   part_end + 1 - part_begin);
         }
 
-        assert(expanded_tail < expanded + MAX_PATH);
+        assert(expanded_tail <= expanded_end);
 
         part_begin = part_end + 1;
     } while (*part_end != '\0');
@@ -84,7 +87,10 @@ char *expand_path(const char *path) {
     return expanded;
 }
 
-RetVal bn_cd(const size_t argc, char *const *const argv) {
+RetVal bn_cd(const size_t argc, char *const *const argv,
+             const BuiltinIO *const io) {
+    (void)io;
+
     CdArgs args;
     if (FAILED(parse_cd_args(&args, argc, argv))) {
         return RETVAL_FAILURE;
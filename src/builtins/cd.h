@@ -1,8 +1,8 @@
 #ifndef __BUILTINS_CD_H__
 #define __BUILTINS_CD_H__
 
-#include "../types.h"
+#include "../builtins.h"
 
-RetVal bn_cd(size_t argc, char *const *argv);
+RetVal bn_cd(size_t argc, char *const *argv, const BuiltinIO *io);
 
 #endif
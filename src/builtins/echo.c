@@ -0,0 +1,38 @@
+#include "echo.h"
+
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    bool               newline;  // cleared by -n
+    const char *const *words;
+    size_t             n_word;
+} EchoArgs;
+
+static void parse_echo_args(EchoArgs *args, const size_t argc,
+                            char *const *const argv) {
+    *args = (EchoArgs){.newline = true, .words = NULL, .n_word = 0};
+
+    size_t i = 1;
+    if (i < argc && strcmp(argv[i], "-n") == 0) {
+        args->newline = false;
+        i++;
+    }
+
+    args->words  = (const char *const *)argv + i;
+    args->n_word = argc - i;
+}
+
+RetVal bn_echo(const size_t argc, char *const *const argv,
+               const BuiltinIO *const io) {
+    EchoArgs args;
+    parse_echo_args(&args, argc, argv);
+
+    for (size_t i = 0; i < args.n_word; i++) {
+        if (i > 0) putc(' ', io->out);
+        fputs(args.words[i], io->out);
+    }
+    if (args.newline) putc('\n', io->out);
+
+    return RETVAL_SUCCESS;
+}
@@ -0,0 +1,8 @@
+#ifndef __BUILTINS_ECHO_H__
+#define __BUILTINS_ECHO_H__
+
+#include "../builtins.h"
+
+RetVal bn_echo(size_t argc, char *const *argv, const BuiltinIO *io);
+
+#endif
@@ -0,0 +1,62 @@
+#include "export.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../io_helpers.h"
+#include "../variables.h"
+
+RetVal bn_export(const size_t argc, char *const *const argv,
+                 const BuiltinIO *const io) {
+    if (argc == 1) {
+        for (const Variable *var = read_variable(NULL); var != NULL;
+             var                 = read_variable(var)) {
+            if (var->exported) {
+                fprintf(io->out, "export %s=%s\n", var->key, var->value);
+            }
+        }
+        return RETVAL_SUCCESS;
+    }
+
+    RetVal retval = RETVAL_SUCCESS;
+    for (size_t i = 1; i < argc; i++) {
+        if (!export_variable(argv[i])) {
+            display_error("ERROR: export: Invalid name: %s\n", argv[i]);
+            retval = RETVAL_FAILURE;
+        }
+    }
+    return retval;
+}
+
+RetVal bn_unset(const size_t argc, char *const *const argv,
+                const BuiltinIO *const io) {
+    (void)io;
+
+    for (size_t i = 1; i < argc; i++) unset_variable(argv[i]);
+    return RETVAL_SUCCESS;
+}
+
+RetVal bn_local(const size_t argc, char *const *const argv,
+                const BuiltinIO *const io) {
+    (void)io;
+
+    RetVal retval = RETVAL_SUCCESS;
+    for (size_t i = 1; i < argc; i++) {
+        const char  *eq      = strchr(argv[i], '=');
+        const size_t key_len =
+            eq != NULL ? (size_t)(eq - argv[i]) : strlen(argv[i]);
+        if (key_len == 0) {
+            display_error("ERROR: local: Invalid name: %s\n", argv[i]);
+            retval = RETVAL_FAILURE;
+            continue;
+        }
+
+        // without a value, the variable is local and empty
+        const char *value = eq != NULL ? eq + 1 : "";
+        if (!set_local(argv[i], key_len, value, strlen(value))) {
+            display_error("ERROR: local: Not in a function\n");
+            return RETVAL_FAILURE;
+        }
+    }
+    return retval;
+}
@@ -0,0 +1,29 @@
+#ifndef __BUILTINS_EXPORT_H__
+#define __BUILTINS_EXPORT_H__
+
+#include "../builtins.h"
+
+/**
+ * @brief Export variables to the environment of new processes.
+ *
+ * Usage: export [<key>[=<value>] ...]
+ * Without arguments, the exported variables are printed.
+ */
+RetVal bn_export(size_t argc, char *const *argv, const BuiltinIO *io);
+
+/**
+ * @brief Remove variables.
+ *
+ * Usage: unset <key> ...
+ */
+RetVal bn_unset(size_t argc, char *const *argv, const BuiltinIO *io);
+
+/**
+ * @brief Set variables local to the running function, which are restored when
+ * it returns.
+ *
+ * Usage: local <key>[=<value>] ...
+ */
+RetVal bn_local(size_t argc, char *const *argv, const BuiltinIO *io);
+
+#endif
@@ -0,0 +1,81 @@
+#include "hash.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../command_table.h"
+#include "../io_helpers.h"
+
+typedef struct {
+    bool               reset;
+    const char        *path;   // -p <path>
+    const char *const *names;  // remaining operands
+    size_t             n_name;
+} HashArgs;
+
+static RetVal parse_hash_args(HashArgs *args, const size_t argc,
+                              char *const *const argv) {
+    *args = (HashArgs){.reset = false, .path = NULL, .names = NULL};
+
+    size_t i;
+    for (i = 1; i < argc; i++) {
+        const char *token = argv[i];
+        if (token[0] != '-') break;
+
+        if (strcmp(token, "-r") == 0) {
+            args->reset = true;
+
+        } else if (strcmp(token, "-p") == 0) {
+            if (i + 1 >= argc) {
+                display_error("ERROR: hash: -p requires a path\n");
+                return RETVAL_FAILURE;
+            }
+            args->path = argv[++i];
+
+        } else {
+            display_error("ERROR: hash: Invalid option: %s\n", token);
+            return RETVAL_FAILURE;
+        }
+    }
+
+    args->names  = (const char *const *)argv + i;
+    args->n_name = argc - i;
+
+    if (args->path != NULL && args->n_name == 0) {
+        display_error("ERROR: hash: -p requires a command name\n");
+        return RETVAL_FAILURE;
+    }
+
+    return RETVAL_SUCCESS;
+}
+
+RetVal bn_hash(const size_t argc, char *const *const argv,
+               const BuiltinIO *const io) {
+    HashArgs args;
+    if (FAILED(parse_hash_args(&args, argc, argv))) {
+        return RETVAL_FAILURE;
+    }
+
+    if (args.reset) clear_command_table();
+
+    // list cached commands
+    if (!args.reset && args.n_name == 0) {
+        for (const CommandEntry *entry = read_command(NULL); entry != NULL;
+             entry                     = read_command(entry)) {
+            fprintf(io->out, "%s\t%s\n", entry->name, entry->path);
+        }
+        return RETVAL_SUCCESS;
+    }
+
+    RetVal retval = RETVAL_SUCCESS;
+    for (size_t i = 0; i < args.n_name; i++) {
+        if (args.path != NULL) {
+            add_command(args.names[i], args.path);
+        } else if (resolve_command(args.names[i]) == NULL) {
+            display_error("ERROR: hash: %s: not found\n", args.names[i]);
+            retval = RETVAL_FAILURE;
+        }
+    }
+
+    return retval;
+}
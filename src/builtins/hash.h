@@ -0,0 +1,8 @@
+#ifndef __BUILTINS_HASH_H__
+#define __BUILTINS_HASH_H__
+
+#include "../builtins.h"
+
+RetVal bn_hash(size_t argc, char *const *argv, const BuiltinIO *io);
+
+#endif
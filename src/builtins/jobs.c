@@ -0,0 +1,152 @@
+#include "jobs.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../background.h"
+#include "../io_helpers.h"
+
+#define SIGNAL_PREFIX "SIG"
+
+typedef struct {
+    const char *name;
+    int         number;
+} SignalName;
+
+static const SignalName SIGNAL_NAMES[] = {
+    {"HUP", SIGHUP},   {"INT", SIGINT},   {"QUIT", SIGQUIT},
+    {"KILL", SIGKILL}, {"USR1", SIGUSR1}, {"USR2", SIGUSR2},
+    {"PIPE", SIGPIPE}, {"ALRM", SIGALRM}, {"TERM", SIGTERM},
+    {"CHLD", SIGCHLD}, {"CONT", SIGCONT}, {"STOP", SIGSTOP},
+    {"TSTP", SIGTSTP},
+};
+#define N_SIGNAL_NAMES (sizeof(SIGNAL_NAMES) / sizeof(SIGNAL_NAMES[0]))
+
+/**
+ * @brief Parse a non-negative decimal number.
+ * @return false if str is not a number.
+ */
+static bool parse_number(const char *const str, unsigned long *const number) {
+    if (*str < '0' || *str > '9') return false;
+
+    char *end;
+    errno   = 0;
+    *number = strtoul(str, &end, 10);
+    return errno == 0 && *end == '\0';
+}
+
+/**
+ * @return The number of the signal, or -1 if the name is unknown.
+ */
+static int parse_signal(const char *name) {
+    unsigned long number;
+    if (parse_number(name, &number)) return number < NSIG ? (int)number : -1;
+
+    if (strncmp(name, SIGNAL_PREFIX, strlen(SIGNAL_PREFIX)) == 0) {
+        name += strlen(SIGNAL_PREFIX);
+    }
+    for (size_t i = 0; i < N_SIGNAL_NAMES; i++) {
+        if (strcmp(name, SIGNAL_NAMES[i].name) == 0) {
+            return SIGNAL_NAMES[i].number;
+        }
+    }
+    return -1;
+}
+
+RetVal bn_jobs(const size_t argc, char *const *const argv,
+               const BuiltinIO *const io) {
+    (void)argc;
+    (void)argv;
+
+    for (const JobInfo *job = read_job(NULL); job != NULL;
+         job                = read_job(job)) {
+        fprintf(io->out, "[%zu]  %s\t%s\n", job->id,
+                job->spec != NULL ? "Queued" : "Running", job->cmd);
+    }
+    return RETVAL_SUCCESS;
+}
+
+RetVal bn_wait(const size_t argc, char *const *const argv,
+               const BuiltinIO *const io) {
+    (void)io;
+
+    if (argc == 1) {
+        return wait_all_jobs() == EXIT_SUCCESS ? RETVAL_SUCCESS
+                                               : RETVAL_FALSE;
+    }
+
+    // the status of the last job, as in $?
+    int status = EXIT_SUCCESS;
+    for (size_t i = 1; i < argc; i++) {
+        const char *const arg = argv[i][0] == '%' ? argv[i] + 1 : argv[i];
+
+        unsigned long id;
+        if (!parse_number(arg, &id)) {
+            display_error("ERROR: wait: Invalid job: %s\n", argv[i]);
+            return RETVAL_FAILURE;
+        }
+
+        status = wait_job(id);
+        if (status == -1) {
+            display_error("ERROR: wait: No such job: %s\n", argv[i]);
+            return RETVAL_FAILURE;
+        }
+        if (status == 128 + SIGINT) break;
+    }
+    return status == EXIT_SUCCESS ? RETVAL_SUCCESS : RETVAL_FALSE;
+}
+
+RetVal bn_kill(const size_t argc, char *const *const argv,
+               const BuiltinIO *const io) {
+    (void)io;
+
+    int    sig = SIGTERM;
+    size_t i   = 1;
+    if (i < argc && strcmp(argv[i], "-s") == 0) {
+        if (i + 1 == argc) {
+            display_error("ERROR: kill: -s requires a signal\n");
+            return RETVAL_FAILURE;
+        }
+        sig  = parse_signal(argv[i + 1]);
+        i   += 2;
+    } else if (i < argc && argv[i][0] == '-') {
+        sig = parse_signal(argv[i] + 1);
+        i++;
+    }
+    if (sig == -1) {
+        display_error("ERROR: kill: Invalid signal: %s\n", argv[i - 1]);
+        return RETVAL_FAILURE;
+    }
+    if (i == argc) {
+        display_error("ERROR: kill: No job or process\n");
+        return RETVAL_FAILURE;
+    }
+
+    RetVal retval = RETVAL_SUCCESS;
+    for (; i < argc; i++) {
+        const bool        is_job = argv[i][0] == '%';
+        const char *const arg    = is_job ? argv[i] + 1 : argv[i];
+
+        unsigned long id;
+        if (!parse_number(arg, &id)) {
+            display_error("ERROR: kill: Invalid %s: %s\n",
+                          is_job ? "job" : "pid", argv[i]);
+            retval = RETVAL_FAILURE;
+            continue;
+        }
+
+        if (is_job) {
+            if (!signal_job(id, sig)) {
+                display_error("ERROR: kill: No such job: %s\n", argv[i]);
+                retval = RETVAL_FAILURE;
+            }
+        } else if (kill((pid_t)id, sig) == -1) {
+            display_error("ERROR: kill: Cannot signal: %s\n", argv[i]);
+            retval = RETVAL_FAILURE;
+        }
+    }
+    return retval;
+}
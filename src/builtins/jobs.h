@@ -0,0 +1,32 @@
+#ifndef __BUILTINS_JOBS_H__
+#define __BUILTINS_JOBS_H__
+
+#include "../builtins.h"
+
+/**
+ * @brief List the running and queued background jobs.
+ *
+ * Usage: jobs
+ */
+RetVal bn_jobs(size_t argc, char *const *argv, const BuiltinIO *io);
+
+/**
+ * @brief Wait for background jobs to finish, starting queued ones meanwhile.
+ *
+ * Usage: wait [<n> ...]
+ * Without arguments, all jobs are waited for. A job number may be written as
+ * n or %n.
+ *
+ * @return RETVAL_FALSE if the last job has failed.
+ */
+RetVal bn_wait(size_t argc, char *const *argv, const BuiltinIO *io);
+
+/**
+ * @brief Send a signal to jobs or processes. A queued job is removed.
+ *
+ * Usage: kill [-<signal> | -s <signal>] <%n | pid> ...
+ * The signal is a number or a name such as TERM or SIGTERM, TERM by default.
+ */
+RetVal bn_kill(size_t argc, char *const *argv, const BuiltinIO *io);
+
+#endif
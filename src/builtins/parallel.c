@@ -0,0 +1,443 @@
+#define _GNU_SOURCE
+
+#include "parallel.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../background.h"
+#include "../command_table.h"
+#include "../io_helpers.h"
+#include "../spawn.h"
+#include "../utils/arena.h"
+#include "../utils/copy.h"
+
+#define ARGS_SEPARATOR      ":::"
+#define ARG_PLACEHOLDER     "{}"
+#define INIT_TASKS_CAPACITY 16  // must be a power of 2
+#define INIT_LINE_CAPACITY  4096
+#define TASK_ARENA_SIZE     4096
+
+#define NO_TASK SIZE_MAX  // sequence number of an idle slot
+
+typedef struct {
+    size_t       n_job;       // -j
+    bool         keep_order;  // -k
+    char *const *words;       // the command, with placeholders
+    size_t       n_word;
+    char *const *args;  // the arguments after :::, or NULL to read stdin
+    size_t       n_arg;
+} ParallelArgs;
+
+/**
+ * A started task. Its output is kept in memory files until it is printed, so
+ * that the output of tasks running at once does not interleave.
+ */
+typedef struct {
+    int  out_fd;  // -1 once printed
+    int  err_fd;
+    bool done;
+} Task;
+
+/**
+ * Tasks not printed yet, in the order they were started.
+ */
+typedef struct {
+    Task  *tasks;     // indexed by sequence number modulo capacity
+    size_t capacity;  // a power of 2
+    size_t first;     // sequence number of the first task not printed
+    size_t next;      // sequence number of the next task
+} TaskQueue;
+
+/**
+ * Lines of stdin read on demand, so that tasks start before the input ends.
+ */
+typedef struct {
+    int    fd;
+    char  *buf;
+    size_t start;  // of the next line
+    size_t len;
+    size_t capacity;
+    bool   eof;
+} LineReader;
+
+static RetVal parse_parallel_args(ParallelArgs *const args, const size_t argc,
+                                  char *const *const argv) {
+    const long n_cpu = sysconf(_SC_NPROCESSORS_ONLN);
+    *args = (ParallelArgs){.n_job = n_cpu > 0 ? n_cpu : 1, .keep_order = false};
+
+    size_t i;
+    for (i = 1; i < argc; i++) {
+        const char *token = argv[i];
+        if (token[0] != '-' || token[1] == '\0') break;
+
+        if (strcmp(token, "-k") == 0) {
+            args->keep_order = true;
+            continue;
+        }
+        if (strncmp(token, "-j", 2) != 0) {
+            display_error("ERROR: parallel: Invalid option: %s\n", token);
+            return RETVAL_FAILURE;
+        }
+
+        // -j <n> or -j<n>
+        const char *value = token + 2;
+        if (*value == '\0') {
+            if (i + 1 == argc) {
+                display_error("ERROR: parallel: -j requires a number\n");
+                return RETVAL_FAILURE;
+            }
+            value = argv[++i];
+        }
+        char *end;
+        errno                 = 0;
+        const unsigned long n = strtoul(value, &end, 10);
+        if (errno != 0 || *end != '\0' || n == 0 || value[0] == '-') {
+            display_error("ERROR: parallel: Invalid number of jobs: %s\n",
+                          value);
+            return RETVAL_FAILURE;
+        }
+        args->n_job = n;
+    }
+
+    args->words = argv + i;
+    while (i < argc && strcmp(argv[i], ARGS_SEPARATOR) != 0) i++;
+    args->n_word = argv + i - args->words;
+    if (i < argc) {
+        args->args  = argv + i + 1;
+        args->n_arg = argc - i - 1;
+    }
+
+    if (args->n_word == 0) {
+        display_error("ERROR: parallel: No command\n");
+        return RETVAL_FAILURE;
+    }
+    return RETVAL_SUCCESS;
+}
+
+// ========== Input ==========
+
+/**
+ * @return The next non-empty line without its newline, valid until the next
+ * call, or NULL at the end of the input.
+ */
+static const char *read_arg_line(LineReader *const reader) {
+    while (true) {
+        char *const begin = reader->buf + reader->start;
+        char *const nl    = memchr(begin, '\n', reader->len - reader->start);
+        if (nl != NULL) {
+            *nl           = '\0';
+            reader->start = nl + 1 - reader->buf;
+            if (nl == begin) continue;
+            return begin;
+        }
+
+        if (reader->eof) {
+            // the last line may lack a newline
+            if (reader->start == reader->len) return NULL;
+            reader->buf[reader->len] = '\0';
+            reader->start            = reader->len;
+            return begin;
+        }
+
+        // keep the partial line at the front, with room for a NUL
+        reader->len -= reader->start;
+        memmove(reader->buf, begin, reader->len);
+        reader->start = 0;
+        if (reader->len + 1 == reader->capacity) {
+            reader->capacity *= 2;
+            reader->buf       = realloc(reader->buf, reader->capacity);
+        }
+
+        // also interrupted by SIGINT, which ends the input
+        const ssize_t read_len = read(reader->fd, reader->buf + reader->len,
+                                      reader->capacity - reader->len - 1);
+        if (read_len <= 0) {
+            reader->eof = true;
+        } else {
+            reader->len += read_len;
+        }
+    }
+}
+
+// ========== Tasks ==========
+
+/**
+ * @brief Build the arguments of a task by replacing the placeholders of the
+ * command with arg, or appending arg if there is none.
+ */
+static char **build_task_argv(const ParallelArgs *const args,
+                              const char *const arg, Arena *const arena) {
+    const size_t placeholder_len = strlen(ARG_PLACEHOLDER);
+    const size_t arg_len         = strlen(arg);
+
+    char **const argv = arena_alloc(arena, (args->n_word + 2) * sizeof(char *));
+    bool         replaced = false;
+    for (size_t i = 0; i < args->n_word; i++) {
+        const char *const word = args->words[i];
+
+        size_t n_placeholder = 0;
+        for (const char *p = word; (p = strstr(p, ARG_PLACEHOLDER)) != NULL;
+             p += placeholder_len) {
+            n_placeholder++;
+        }
+        if (n_placeholder == 0) {
+            argv[i] = (char *)word;
+            continue;
+        }
+        replaced = true;
+
+        const size_t len = strlen(word) - n_placeholder * placeholder_len +
+                           n_placeholder * arg_len;
+        char *const  out = arena_alloc(arena, len + 1);
+        char        *dst = out;
+        const char  *src = word;
+        for (const char *p; (p = strstr(src, ARG_PLACEHOLDER)) != NULL;
+             src = p + placeholder_len) {
+            memcpy(dst, src, p - src);
+            dst += p - src;
+            memcpy(dst, arg, arg_len);
+            dst += arg_len;
+        }
+        strcpy(dst, src);
+        argv[i] = out;
+    }
+
+    size_t n = args->n_word;
+    if (!replaced) argv[n++] = arena_strndup(arena, arg, arg_len);
+    argv[n] = NULL;
+    return argv;
+}
+
+/**
+ * @brief Start a task with its output going to new memory files.
+ * @return The pid of the task, or -1 on error.
+ */
+static pid_t start_task(char *const *const argv, const int null_fd,
+                        Task *const task) {
+    const char *const path = resolve_command(argv[0]);
+    if (path == NULL) {
+        display_error("ERROR: parallel: Unknown command: %s\n", argv[0]);
+        return -1;
+    }
+
+    task->out_fd = memfd_create("mysh-parallel", MFD_CLOEXEC);
+    task->err_fd = memfd_create("mysh-parallel", MFD_CLOEXEC);
+    if (task->out_fd == -1 || task->err_fd == -1) {
+        display_error("ERROR: parallel: Cannot create output file\n");
+        if (task->out_fd != -1) close(task->out_fd);
+        if (task->err_fd != -1) close(task->err_fd);
+        task->out_fd = -1;
+        return -1;
+    }
+
+    const FdMapping stderr_mapping = {.fd     = STDERR_FILENO,
+                                      .source = task->err_fd};
+    const SpawnAttr attr = {
+        .stdin_fd  = null_fd,
+        .stdout_fd = task->out_fd,
+        .pgid      = SPAWN_PGID_INHERIT,
+        .mappings  = &stderr_mapping,
+        .n_mapping = 1,
+    };
+    const pid_t pid = spawn_executable(path, argv, &attr);
+    if (pid == -1) {
+        display_error("ERROR: parallel: Cannot run: %s\n", argv[0]);
+        close(task->out_fd);
+        close(task->err_fd);
+        task->out_fd = -1;
+    }
+    return pid;
+}
+
+/**
+ * @brief Copy the output of a finished task, and release its files.
+ */
+static void print_task(Task *const task, const int out_fd) {
+    if (task->out_fd == -1) return;
+
+    lseek(task->out_fd, 0, SEEK_SET);
+    copy_fd(task->out_fd, out_fd);
+    lseek(task->err_fd, 0, SEEK_SET);
+    copy_fd(task->err_fd, STDERR_FILENO);
+
+    close(task->out_fd);
+    close(task->err_fd);
+    task->out_fd = -1;
+}
+
+static Task *get_task(const TaskQueue *const queue, const size_t seq) {
+    return &queue->tasks[seq & (queue->capacity - 1)];
+}
+
+/**
+ * @return The sequence number of a new task at the end of the queue.
+ */
+static size_t push_task(TaskQueue *const queue) {
+    if (queue->next - queue->first == queue->capacity) {
+        // the sequence numbers in the queue are distinct modulo any larger
+        // capacity, so the tasks can be moved one by one
+        TaskQueue grown = *queue;
+        grown.capacity  = queue->capacity * 2;
+        grown.tasks     = malloc(grown.capacity * sizeof(Task));
+        for (size_t seq = queue->first; seq < queue->next; seq++) {
+            *get_task(&grown, seq) = *get_task(queue, seq);
+        }
+        free(queue->tasks);
+        *queue = grown;
+    }
+
+    *get_task(queue, queue->next) = (Task){.out_fd = -1, .done = false};
+    return queue->next++;
+}
+
+/**
+ * @brief Print the finished tasks at the front of the queue, and remove them.
+ */
+static void flush_tasks(TaskQueue *const queue, const int out_fd) {
+    while (queue->first < queue->next) {
+        Task *const task = get_task(queue, queue->first);
+        if (!task->done) break;
+        print_task(task, out_fd);
+        queue->first++;
+    }
+}
+
+// ========== Builtin ==========
+
+RetVal bn_parallel(const size_t argc, char *const *const argv,
+                   const BuiltinIO *const io) {
+    ParallelArgs args;
+    if (FAILED(parse_parallel_args(&args, argc, argv))) {
+        return RETVAL_FAILURE;
+    }
+    if (strstr(args.words[0], ARG_PLACEHOLDER) == NULL &&
+        resolve_command(args.words[0]) == NULL) {
+        display_error("ERROR: parallel: Unknown command: %s\n", args.words[0]);
+        return RETVAL_FAILURE;
+    }
+
+    // tasks must not read the arguments, nor the terminal
+    const int null_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (null_fd == -1) {
+        display_error("ERROR: parallel: Cannot open /dev/null\n");
+        return RETVAL_FAILURE;
+    }
+
+    // bypass stdio, so flush what is buffered first
+    fflush(io->out);
+    const int out_fd = fileno(io->out);
+
+    // slot i runs the task slot_seqs[i] as process pids[i], waited for
+    // through pidfds[i] until it is reaped
+    pid_t *const  pids      = malloc(args.n_job * sizeof(pid_t));
+    int *const    pidfds    = malloc(args.n_job * sizeof(int));
+    int *const    statuses  = malloc(args.n_job * sizeof(int));
+    size_t *const slot_seqs = malloc(args.n_job * sizeof(size_t));
+    for (size_t i = 0; i < args.n_job; i++) {
+        pids[i]      = -1;
+        pidfds[i]    = -1;
+        slot_seqs[i] = NO_TASK;
+    }
+
+    TaskQueue queue = {.tasks    = malloc(INIT_TASKS_CAPACITY * sizeof(Task)),
+                       .capacity = INIT_TASKS_CAPACITY};
+    LineReader reader = {.fd       = io->in_fd,
+                         .buf      = malloc(INIT_LINE_CAPACITY),
+                         .capacity = INIT_LINE_CAPACITY};
+    Arena      arena;
+    arena_init(&arena, TASK_ARENA_SIZE);
+
+    size_t i_arg       = 0;
+    size_t n_running   = 0;
+    size_t n_failed    = 0;
+    bool   more        = true;
+    bool   interrupted = false;
+    size_t free_slot   = 0;  // a slot to try first
+    while (true) {
+        // fill the free slots
+        while (more && !interrupted && n_running < args.n_job) {
+            const char *arg;
+            if (args.args != NULL) {
+                arg = i_arg < args.n_arg ? args.args[i_arg++] : NULL;
+            } else {
+                arg = read_arg_line(&reader);
+            }
+            if (arg == NULL) {
+                more = false;
+                break;
+            }
+
+            while (slot_seqs[free_slot] != NO_TASK) {
+                free_slot = (free_slot + 1) % args.n_job;
+            }
+
+            // the arguments are only needed to start the task
+            const ArenaMark    mark      = arena_mark(&arena);
+            char *const *const task_argv = build_task_argv(&args, arg, &arena);
+            const size_t       seq       = push_task(&queue);
+            Task *const        task      = get_task(&queue, seq);
+            const pid_t        pid = start_task(task_argv, null_fd, task);
+            arena_rewind(&arena, mark);
+
+            if (pid == -1) {
+                task->done = true;
+                n_failed++;
+                continue;
+            }
+            pids[free_slot]      = pid;
+            pidfds[free_slot]    = open_child_pidfd(pid);
+            slot_seqs[free_slot] = seq;
+            n_running++;
+        }
+        if (n_running == 0) break;
+
+        // start the next task as soon as one exits
+        if (wait_any_child(pids, pidfds, statuses, args.n_job) == 0) {
+            // stop starting tasks after SIGINT, and pass it to the running
+            // ones, which may not be in the foreground process group
+            if (!interrupted) {
+                interrupted = true;
+                for (size_t i = 0; i < args.n_job; i++) {
+                    if (pids[i] != -1) kill(pids[i], SIGINT);
+                }
+            }
+            continue;
+        }
+
+        for (size_t i = 0; i < args.n_job; i++) {
+            if (slot_seqs[i] == NO_TASK || pids[i] != -1) continue;
+
+            const int status = exit_status(statuses[i]);
+            if (status != EXIT_SUCCESS) n_failed++;
+            if (status == 128 + SIGINT) interrupted = true;
+
+            Task *const task = get_task(&queue, slot_seqs[i]);
+            task->done       = true;
+            if (!args.keep_order) print_task(task, out_fd);
+
+            slot_seqs[i] = NO_TASK;
+            free_slot    = i;
+            n_running--;
+        }
+        flush_tasks(&queue, out_fd);
+    }
+    flush_tasks(&queue, out_fd);
+
+    arena_free(&arena);
+    free(reader.buf);
+    free(queue.tasks);
+    free(slot_seqs);
+    free(statuses);
+    free(pidfds);
+    free(pids);
+    close(null_fd);
+
+    return n_failed > 0 || interrupted ? RETVAL_FALSE : RETVAL_SUCCESS;
+}
@@ -0,0 +1,21 @@
+#ifndef __BUILTINS_PARALLEL_H__
+#define __BUILTINS_PARALLEL_H__
+
+#include "../builtins.h"
+
+/**
+ * @brief Run a command once per argument, on a bounded pool of processes.
+ *
+ * Usage: parallel [-j <n>] [-k] <command> [<word> ...] [::: <arg> ...]
+ *
+ * Each {} in the words is replaced by the argument, which is appended if there
+ * is none. Without :::, the arguments are the lines of stdin. At most n tasks
+ * run at once, n being the number of CPUs by default, and a task starts as
+ * soon as another one exits. The output of a task is printed as a whole when
+ * it exits, or in the order of the arguments with -k.
+ *
+ * @return RETVAL_FALSE if any task has failed.
+ */
+RetVal bn_parallel(size_t argc, char *const *argv, const BuiltinIO *io);
+
+#endif
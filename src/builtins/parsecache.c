@@ -0,0 +1,21 @@
+#include "parsecache.h"
+
+#include "../io_helpers.h"
+#include "../parse_cache.h"
+
+RetVal bn_parsecache(const size_t argc, char *const *const argv,
+                     const BuiltinIO *const io) {
+    (void)argv;
+
+    if (argc > 1) {
+        display_error("ERROR: Too many arguments: parsecache takes none\n");
+        return RETVAL_FAILURE;
+    }
+
+    const ParseCacheStats stats = get_parse_cache_stats();
+    fprintf(io->out, "hits\t%zu\n", stats.hits);
+    fprintf(io->out, "misses\t%zu\n", stats.misses);
+    fprintf(io->out, "entries\t%zu/%zu\n", stats.n_entry, stats.capacity);
+
+    return RETVAL_SUCCESS;
+}
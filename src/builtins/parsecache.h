@@ -0,0 +1,8 @@
+#ifndef __BUILTINS_PARSECACHE_H__
+#define __BUILTINS_PARSECACHE_H__
+
+#include "../builtins.h"
+
+RetVal bn_parsecache(size_t argc, char *const *argv, const BuiltinIO *io);
+
+#endif
@@ -0,0 +1,171 @@
+#include "printf.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../io_helpers.h"
+
+#define MAX_SPEC_LEN 32
+
+/**
+ * @brief Print the escape sequence starting after a '\'.
+ * @return Pointer to the character after the sequence.
+ */
+static const char *print_escape(FILE *const out, const char *const esc) {
+    switch (*esc) {
+        case 'n':
+            putc('\n', out);
+            return esc + 1;
+        case 't':
+            putc('\t', out);
+            return esc + 1;
+        case 'r':
+            putc('\r', out);
+            return esc + 1;
+        case 'a':
+            putc('\a', out);
+            return esc + 1;
+        case '\\':
+            putc('\\', out);
+            return esc + 1;
+        case '\0':
+            putc('\\', out);
+            return esc;
+        default:
+            // unknown escapes are printed as is
+            putc('\\', out);
+            putc(*esc, out);
+            return esc + 1;
+    }
+}
+
+/**
+ * @brief Print a conversion of the next argument.
+ *
+ * @param [in] out The stream to print to.
+ * @param [in] spec The conversion specification without the conversion
+ * character, e.g. "%-8".
+ * @param [in] conv The conversion character.
+ * @param [in] arg The argument, or NULL if there is none left.
+ */
+static RetVal print_conversion(FILE *const out, const char *const spec,
+                               const char conv, const char *const arg) {
+    char format[MAX_SPEC_LEN + 4];
+
+    switch (conv) {
+        case 's':
+            snprintf(format, sizeof(format), "%ss", spec);
+            fprintf(out, format, arg != NULL ? arg : "");
+            return RETVAL_SUCCESS;
+
+        case 'c':
+            snprintf(format, sizeof(format), "%sc", spec);
+            fprintf(out, format, arg != NULL ? arg[0] : '\0');
+            return RETVAL_SUCCESS;
+
+        case 'd':
+        case 'i': {
+            char *end;
+            errno                = 0;
+            const long long value = arg != NULL ? strtoll(arg, &end, 0) : 0;
+            if (arg != NULL && (*end != '\0' || errno != 0)) {
+                display_error("ERROR: printf: Invalid number: %s\n", arg);
+                return RETVAL_FAILURE;
+            }
+            snprintf(format, sizeof(format), "%sll%c", spec, conv);
+            fprintf(out, format, value);
+            return RETVAL_SUCCESS;
+        }
+
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X': {
+            char *end;
+            errno = 0;
+            const unsigned long long value =
+                arg != NULL ? strtoull(arg, &end, 0) : 0;
+            if (arg != NULL && (*end != '\0' || errno != 0)) {
+                display_error("ERROR: printf: Invalid number: %s\n", arg);
+                return RETVAL_FAILURE;
+            }
+            snprintf(format, sizeof(format), "%sll%c", spec, conv);
+            fprintf(out, format, value);
+            return RETVAL_SUCCESS;
+        }
+
+        default:
+            display_error("ERROR: printf: Invalid conversion: %%%c\n", conv);
+            return RETVAL_FAILURE;
+    }
+}
+
+/**
+ * @brief Print the format once, consuming arguments from *args.
+ */
+static RetVal print_format(FILE *const out, const char *const format,
+                           char *const **const args,
+                           char *const *const args_end) {
+    const char *curr = format;
+    while (*curr != '\0') {
+        // print plain text up to the next '\' or '%'
+        const size_t plain = strcspn(curr, "\\%");
+        fwrite(curr, 1, plain, out);
+        curr += plain;
+
+        if (*curr == '\\') {
+            curr = print_escape(out, curr + 1);
+
+        } else if (*curr == '%') {
+            if (curr[1] == '%') {
+                putc('%', out);
+                curr += 2;
+                continue;
+            }
+
+            // flags, width and precision are passed to printf as is
+            const size_t spec_len = 1 + strspn(curr + 1, "-+ #0123456789.");
+            if (spec_len > MAX_SPEC_LEN) {
+                display_error("ERROR: printf: Conversion too long\n");
+                return RETVAL_FAILURE;
+            }
+            char spec[MAX_SPEC_LEN + 1];
+            memcpy(spec, curr, spec_len);
+            spec[spec_len] = '\0';
+            curr += spec_len;
+
+            const char *const arg = *args < args_end ? *(*args)++ : NULL;
+            if (FAILED(print_conversion(out, spec, *curr, arg))) {
+                return RETVAL_FAILURE;
+            }
+            if (*curr != '\0') curr++;
+        }
+    }
+
+    return RETVAL_SUCCESS;
+}
+
+RetVal bn_printf(const size_t argc, char *const *const argv,
+                 const BuiltinIO *const io) {
+    if (argc < 2) {
+        display_error("ERROR: printf: Missing format\n");
+        return RETVAL_FAILURE;
+    }
+
+    const char *const  format   = argv[1];
+    char *const       *args     = argv + 2;
+    char *const *const args_end = argv + argc;
+
+    // the format is reused as long as arguments remain
+    do {
+        char *const *const prev = args;
+        if (FAILED(print_format(io->out, format, &args, args_end))) {
+            return RETVAL_FAILURE;
+        }
+        if (args == prev) break;  // no conversion in format
+    } while (args < args_end);
+
+    return RETVAL_SUCCESS;
+}
@@ -0,0 +1,8 @@
+#ifndef __BUILTINS_PRINTF_H__
+#define __BUILTINS_PRINTF_H__
+
+#include "../builtins.h"
+
+RetVal bn_printf(size_t argc, char *const *argv, const BuiltinIO *io);
+
+#endif
@@ -0,0 +1,27 @@
+#include "pwd.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../io_helpers.h"
+
+RetVal bn_pwd(const size_t argc, char *const *const argv,
+              const BuiltinIO *const io) {
+    (void)argv;
+
+    if (argc > 1) {
+        display_error("ERROR: Too many arguments: pwd takes none\n");
+        return RETVAL_FAILURE;
+    }
+
+    char *const cwd = getcwd(NULL, 0);
+    if (cwd == NULL) {
+        display_error("ERROR: pwd: Cannot get current directory\n");
+        return RETVAL_FAILURE;
+    }
+
+    fprintf(io->out, "%s\n", cwd);
+    free(cwd);
+
+    return RETVAL_SUCCESS;
+}
@@ -0,0 +1,8 @@
+#ifndef __BUILTINS_PWD_H__
+#define __BUILTINS_PWD_H__
+
+#include "../builtins.h"
+
+RetVal bn_pwd(size_t argc, char *const *argv, const BuiltinIO *io);
+
+#endif
@@ -0,0 +1,151 @@
+#define _GNU_SOURCE
+
+#include "tee.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../io_helpers.h"
+#include "../utils/copy.h"
+
+#define TEE_BUFFER_SIZE (1 << 17)
+#define TEE_CHUNK_SIZE  (1 << 30)
+
+typedef struct {
+    bool               append;  // -a
+    const char *const *files;
+    size_t             n_file;
+} TeeArgs;
+
+static RetVal parse_tee_args(TeeArgs *args, const size_t argc,
+                             char *const *const argv) {
+    *args = (TeeArgs){.append = false, .files = NULL, .n_file = 0};
+
+    size_t i;
+    for (i = 1; i < argc; i++) {
+        const char *token = argv[i];
+        if (token[0] != '-' || token[1] == '\0') break;
+
+        if (strcmp(token, "-a") == 0) {
+            args->append = true;
+        } else {
+            display_error("ERROR: tee: Invalid option: %s\n", token);
+            return RETVAL_FAILURE;
+        }
+    }
+
+    args->files  = (const char *const *)argv + i;
+    args->n_file = argc - i;
+
+    return RETVAL_SUCCESS;
+}
+
+static bool is_pipe(const int fd) {
+    struct stat st;
+    return fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+/**
+ * @brief Duplicate in_fd to out_fd and file_fd without copying through user
+ * space. Both in_fd and out_fd must be pipes.
+ *
+ * @return 0 on EOF, -1 on error, or 1 if nothing was copied because the
+ * kernel does not support it.
+ */
+static int tee_splice(const int in_fd, const int out_fd, const int file_fd) {
+    bool copied = false;
+    while (true) {
+        // copy to out_fd without consuming the input
+        const ssize_t len = tee(in_fd, out_fd, TEE_CHUNK_SIZE, 0);
+        if (len == 0) return 0;
+        if (len == -1) return !copied && errno == EINVAL ? 1 : -1;
+        copied = true;
+
+        // then move the same bytes to the file
+        for (ssize_t moved = 0; moved < len;) {
+            const ssize_t n = splice(in_fd, NULL, file_fd, NULL, len - moved,
+                                     SPLICE_F_MOVE);
+            if (n <= 0) return -1;
+            moved += n;
+        }
+    }
+}
+
+/**
+ * @brief Duplicate in_fd to out_fd and all fds through a buffer.
+ */
+static int tee_buffer(const int in_fd, const int out_fd, const int *const fds,
+                      const size_t n_fd) {
+    char *const buf    = malloc(TEE_BUFFER_SIZE);
+    int         result = 0;
+    while (true) {
+        const ssize_t len = read(in_fd, buf, TEE_BUFFER_SIZE);
+        if (len == 0) break;
+        if (len == -1 || !write_all(out_fd, buf, len)) {
+            result = -1;
+            break;
+        }
+        for (size_t i = 0; i < n_fd; i++) {
+            if (!write_all(fds[i], buf, len)) result = -1;
+        }
+        if (result == -1) break;
+    }
+    free(buf);
+
+    return result;
+}
+
+RetVal bn_tee(const size_t argc, char *const *const argv,
+              const BuiltinIO *const io) {
+    TeeArgs args;
+    if (FAILED(parse_tee_args(&args, argc, argv))) {
+        return RETVAL_FAILURE;
+    }
+
+    // bypass stdio, so flush what is buffered first
+    fflush(io->out);
+    const int out_fd = fileno(io->out);
+
+    const int flags =
+        O_WRONLY | O_CREAT | O_CLOEXEC | (args.append ? O_APPEND : O_TRUNC);
+    int *const fds  = malloc(args.n_file * sizeof(int));
+    size_t     n_fd = 0;
+
+    RetVal retval = RETVAL_SUCCESS;
+    for (size_t i = 0; i < args.n_file; i++) {
+        const int fd = open(args.files[i], flags, 0644);
+        if (fd == -1) {
+            display_error("ERROR: tee: Cannot open file: %s\n", args.files[i]);
+            retval = RETVAL_FAILURE;
+            continue;
+        }
+        fds[n_fd++] = fd;
+    }
+
+    int result = 1;
+    if (n_fd == 0) {
+        result = copy_fd(io->in_fd, out_fd) == -1 ? -1 : 0;
+    } else if (n_fd == 1 && is_pipe(io->in_fd) && is_pipe(out_fd)) {
+        result = tee_splice(io->in_fd, out_fd, fds[0]);
+    }
+    if (result == 1) result = tee_buffer(io->in_fd, out_fd, fds, n_fd);
+
+    if (result == -1 && errno == EPIPE) {
+        // the reader has gone, which ends tee quietly like SIGPIPE would
+        retval = RETVAL_FALSE;
+    } else if (result == -1) {
+        // also interrupted by SIGINT
+        display_error("ERROR: tee: Cannot copy\n");
+        retval = RETVAL_FAILURE;
+    }
+
+    for (size_t i = 0; i < n_fd; i++) close(fds[i]);
+    free(fds);
+
+    return retval;
+}
@@ -0,0 +1,8 @@
+#ifndef __BUILTINS_TEE_H__
+#define __BUILTINS_TEE_H__
+
+#include "../builtins.h"
+
+RetVal bn_tee(size_t argc, char *const *argv, const BuiltinIO *io);
+
+#endif
@@ -0,0 +1,138 @@
+#define _DEFAULT_SOURCE
+
+#include "test.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../io_helpers.h"
+
+// Result of an expression, or RETVAL_FAILURE on error
+#define TEST_TRUE  RETVAL_SUCCESS
+#define TEST_FALSE RETVAL_FALSE
+
+static RetVal to_result(const bool value) {
+    return value ? TEST_TRUE : TEST_FALSE;
+}
+
+static bool parse_integer(const char *const str, long long *const value) {
+    char *end;
+    errno  = 0;
+    *value = strtoll(str, &end, 10);
+    return end != str && *end == '\0' && errno == 0;
+}
+
+static bool is_unary_op(const char *const op) {
+    return op[0] == '-' && op[1] != '\0' && op[2] == '\0' &&
+           strchr("edfrwxsnz", op[1]) != NULL;
+}
+
+static bool is_binary_op(const char *const op) {
+    static const char *const OPS[] = {"=",   "!=",  "-eq", "-ne",
+                                      "-lt", "-le", "-gt", "-ge"};
+    for (size_t i = 0; i < sizeof(OPS) / sizeof(OPS[0]); i++) {
+        if (strcmp(op, OPS[i]) == 0) return true;
+    }
+    return false;
+}
+
+static RetVal eval_unary(const char *const op, const char *const operand) {
+    if (op[1] == 'n') return to_result(operand[0] != '\0');
+    if (op[1] == 'z') return to_result(operand[0] == '\0');
+    if (op[1] == 'r') return to_result(access(operand, R_OK) == 0);
+    if (op[1] == 'w') return to_result(access(operand, W_OK) == 0);
+    if (op[1] == 'x') return to_result(access(operand, X_OK) == 0);
+
+    struct stat st;
+    if (stat(operand, &st) == -1) return TEST_FALSE;
+
+    switch (op[1]) {
+        case 'e':
+            return TEST_TRUE;
+        case 'd':
+            return to_result(S_ISDIR(st.st_mode));
+        case 'f':
+            return to_result(S_ISREG(st.st_mode));
+        case 's':
+            return to_result(st.st_size > 0);
+        default:
+            return RETVAL_FAILURE;
+    }
+}
+
+static RetVal eval_binary(const char *const lhs, const char *const op,
+                          const char *const rhs) {
+    if (strcmp(op, "=") == 0) return to_result(strcmp(lhs, rhs) == 0);
+    if (strcmp(op, "!=") == 0) return to_result(strcmp(lhs, rhs) != 0);
+
+    long long l, r;
+    if (!parse_integer(lhs, &l) || !parse_integer(rhs, &r)) {
+        display_error("ERROR: test: Integer expected\n");
+        return RETVAL_FAILURE;
+    }
+
+    if (strcmp(op, "-eq") == 0) return to_result(l == r);
+    if (strcmp(op, "-ne") == 0) return to_result(l != r);
+    if (strcmp(op, "-lt") == 0) return to_result(l < r);
+    if (strcmp(op, "-le") == 0) return to_result(l <= r);
+    if (strcmp(op, "-gt") == 0) return to_result(l > r);
+    return to_result(l >= r);  // -ge
+}
+
+static RetVal negate(const RetVal result) {
+    if (FAILED(result)) return result;
+    return result == TEST_TRUE ? TEST_FALSE : TEST_TRUE;
+}
+
+/**
+ * @brief Evaluate the operands by their count, as specified by POSIX.
+ */
+static RetVal eval(const size_t n, char *const *const args) {
+    switch (n) {
+        case 0:
+            return TEST_FALSE;
+
+        case 1:
+            return to_result(args[0][0] != '\0');
+
+        case 2:
+            if (strcmp(args[0], "!") == 0) return negate(eval(1, args + 1));
+            if (is_unary_op(args[0])) return eval_unary(args[0], args[1]);
+            break;
+
+        case 3:
+            if (is_binary_op(args[1])) {
+                return eval_binary(args[0], args[1], args[2]);
+            }
+            if (strcmp(args[0], "!") == 0) return negate(eval(2, args + 1));
+            break;
+
+        case 4:
+            if (strcmp(args[0], "!") == 0) return negate(eval(3, args + 1));
+            break;
+    }
+
+    display_error("ERROR: test: Invalid expression\n");
+    return RETVAL_FAILURE;
+}
+
+RetVal bn_test(const size_t argc, char *const *const argv,
+               const BuiltinIO *const io) {
+    (void)io;
+
+    return eval(argc - 1, argv + 1);
+}
+
+RetVal bn_bracket(const size_t argc, char *const *const argv,
+                  const BuiltinIO *const io) {
+    (void)io;
+
+    if (strcmp(argv[argc - 1], "]") != 0) {
+        display_error("ERROR: [: Missing `]'\n");
+        return RETVAL_FAILURE;
+    }
+    return eval(argc - 2, argv + 1);
+}
@@ -0,0 +1,17 @@
+#ifndef __BUILTINS_TEST_H__
+#define __BUILTINS_TEST_H__
+
+#include "../builtins.h"
+
+/**
+ * @return RETVAL_SUCCESS if the expression is true, RETVAL_FALSE if it is
+ * false, or RETVAL_FAILURE on a syntax error.
+ */
+RetVal bn_test(size_t argc, char *const *argv, const BuiltinIO *io);
+
+/**
+ * @brief Same as test, but the last argument must be "]".
+ */
+RetVal bn_bracket(size_t argc, char *const *argv, const BuiltinIO *io);
+
+#endif
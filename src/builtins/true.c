@@ -0,0 +1,19 @@
+#include "true.h"
+
+RetVal bn_true(const size_t argc, char *const *const argv,
+               const BuiltinIO *const io) {
+    (void)argc;
+    (void)argv;
+    (void)io;
+
+    return RETVAL_SUCCESS;
+}
+
+RetVal bn_false(const size_t argc, char *const *const argv,
+                const BuiltinIO *const io) {
+    (void)argc;
+    (void)argv;
+    (void)io;
+
+    return RETVAL_FALSE;
+}
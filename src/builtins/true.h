@@ -0,0 +1,10 @@
+#ifndef __BUILTINS_TRUE_H__
+#define __BUILTINS_TRUE_H__
+
+#include "../builtins.h"
+
+RetVal bn_true(size_t argc, char *const *argv, const BuiltinIO *io);
+
+RetVal bn_false(size_t argc, char *const *argv, const BuiltinIO *io);
+
+#endif
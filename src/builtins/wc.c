@@ -0,0 +1,166 @@
+#include "wc.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../io_helpers.h"
+
+#define WC_BUFFER_SIZE 65536
+#define WC_WIDTH       7
+
+typedef struct {
+    bool               lines;  // -l
+    bool               words;  // -w
+    bool               bytes;  // -c
+    const char *const *files;
+    size_t             n_file;
+} WcArgs;
+
+typedef struct {
+    size_t lines;
+    size_t words;
+    size_t bytes;
+} WcCounts;
+
+static RetVal parse_wc_args(WcArgs *args, const size_t argc,
+                            char *const *const argv) {
+    *args = (WcArgs){.lines = false, .words = false, .bytes = false};
+
+    size_t i;
+    for (i = 1; i < argc; i++) {
+        const char *token = argv[i];
+        if (token[0] != '-' || token[1] == '\0') break;
+
+        // options may be combined, e.g. -lw
+        for (const char *opt = token + 1; *opt != '\0'; opt++) {
+            if (*opt == 'l') {
+                args->lines = true;
+            } else if (*opt == 'w') {
+                args->words = true;
+            } else if (*opt == 'c') {
+                args->bytes = true;
+            } else {
+                display_error("ERROR: wc: Invalid option: %s\n", token);
+                return RETVAL_FAILURE;
+            }
+        }
+    }
+
+    // count everything by default
+    if (!args->lines && !args->words && !args->bytes) {
+        args->lines = args->words = args->bytes = true;
+    }
+
+    args->files  = (const char *const *)argv + i;
+    args->n_file = argc - i;
+
+    return RETVAL_SUCCESS;
+}
+
+static RetVal count_fd(const int fd, const char *const name,
+                       WcCounts *const counts) {
+    char *const buf    = malloc(WC_BUFFER_SIZE);
+    RetVal      retval = RETVAL_SUCCESS;
+
+    *counts      = (WcCounts){0};
+    bool in_word = false;
+    while (true) {
+        const ssize_t read_len = read(fd, buf, WC_BUFFER_SIZE);
+        if (read_len == 0) break;
+        if (read_len == -1) {
+            // also interrupted by SIGINT
+            display_error("ERROR: wc: Cannot read: %s\n", name);
+            retval = RETVAL_FAILURE;
+            break;
+        }
+
+        counts->bytes += read_len;
+        for (ssize_t i = 0; i < read_len; i++) {
+            const unsigned char c = buf[i];
+            if (c == '\n') counts->lines++;
+
+            const bool space = isspace(c);
+            if (!space && !in_word) counts->words++;
+            in_word = !space;
+        }
+    }
+    free(buf);
+
+    return retval;
+}
+
+static void print_counts(FILE *const out, const WcArgs *const args,
+                         const WcCounts *const counts,
+                         const char *const name) {
+    // align the columns unless there is only one
+    const int width =
+        args->lines + args->words + args->bytes > 1 ? WC_WIDTH : 0;
+
+    const char *sep = "";
+    if (args->lines) {
+        fprintf(out, "%s%*zu", sep, width, counts->lines);
+        sep = " ";
+    }
+    if (args->words) {
+        fprintf(out, "%s%*zu", sep, width, counts->words);
+        sep = " ";
+    }
+    if (args->bytes) {
+        fprintf(out, "%s%*zu", sep, width, counts->bytes);
+    }
+
+    if (name != NULL) fprintf(out, " %s", name);
+    putc('\n', out);
+}
+
+RetVal bn_wc(const size_t argc, char *const *const argv,
+             const BuiltinIO *const io) {
+    WcArgs args;
+    if (FAILED(parse_wc_args(&args, argc, argv))) {
+        return RETVAL_FAILURE;
+    }
+
+    WcCounts counts;
+    if (args.n_file == 0) {
+        if (FAILED(count_fd(io->in_fd, "-", &counts))) {
+            return RETVAL_FAILURE;
+        }
+        print_counts(io->out, &args, &counts, NULL);
+        return RETVAL_SUCCESS;
+    }
+
+    RetVal   retval = RETVAL_SUCCESS;
+    WcCounts total  = {0};
+    for (size_t i = 0; i < args.n_file; i++) {
+        const char *const name = args.files[i];
+
+        const bool is_stdin = strcmp(name, "-") == 0;
+        const int  fd =
+            is_stdin ? io->in_fd : open(name, O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            display_error("ERROR: wc: Cannot open file: %s\n", name);
+            retval = RETVAL_FAILURE;
+            continue;
+        }
+
+        const RetVal count_retval = count_fd(fd, name, &counts);
+        if (!is_stdin) close(fd);
+        if (FAILED(count_retval)) {
+            retval = RETVAL_FAILURE;
+            continue;
+        }
+
+        print_counts(io->out, &args, &counts, name);
+        total.lines += counts.lines;
+        total.words += counts.words;
+        total.bytes += counts.bytes;
+    }
+
+    if (args.n_file > 1) print_counts(io->out, &args, &total, "total");
+
+    return retval;
+}
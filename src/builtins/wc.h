@@ -0,0 +1,8 @@
+#ifndef __BUILTINS_WC_H__
+#define __BUILTINS_WC_H__
+
+#include "../builtins.h"
+
+RetVal bn_wc(size_t argc, char *const *argv, const BuiltinIO *io);
+
+#endif
@@ -0,0 +1,216 @@
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
+
+#include "command_table.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "io_helpers.h"
+#include "utils/hash.h"
+#include "variables.h"
+
+#define DEFAULT_PATH "/bin:/usr/bin"
+
+// How long a failed lookup is remembered
+static const time_t NOT_FOUND_TTL_SEC = 2;
+
+static const size_t INIT_TABLE_CAPACITY = 64;  // must be a power of 2
+
+static CommandEntry *table          = NULL;
+static size_t        table_len      = 0;
+static size_t        table_capacity = 0;
+
+// PATH the cached entries were resolved against
+static char *table_path_env = NULL;
+
+void init_command_table() {
+    table          = calloc(INIT_TABLE_CAPACITY, sizeof(CommandEntry));
+    table_len      = 0;
+    table_capacity = INIT_TABLE_CAPACITY;
+}
+
+void free_command_table() {
+    clear_command_table();
+    free(table);
+    free(table_path_env);
+    table          = NULL;
+    table_capacity = 0;
+    table_path_env = NULL;
+}
+
+void clear_command_table() {
+    for (size_t i = 0; i < table_capacity; i++) {
+        free(table[i].name);
+        free(table[i].path);
+    }
+    memset(table, 0, table_capacity * sizeof(CommandEntry));
+    table_len = 0;
+}
+
+/**
+ * @return The slot holding name, or the empty slot where name should be
+ * inserted.
+ */
+static CommandEntry *find_slot(CommandEntry *const entries,
+                               const size_t capacity, const char *const name,
+                               const uint64_t hash) {
+    const size_t mask = capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        CommandEntry *const entry = &entries[i];
+        if (entry->name == NULL) return entry;
+        if (entry->hash == hash && strcmp(entry->name, name) == 0) {
+            return entry;
+        }
+    }
+}
+
+static void grow_table() {
+    const size_t        new_capacity = table_capacity * 2;
+    CommandEntry *const new_table = calloc(new_capacity, sizeof(CommandEntry));
+
+    for (size_t i = 0; i < table_capacity; i++) {
+        if (table[i].name == NULL) continue;
+        *find_slot(new_table, new_capacity, table[i].name, table[i].hash) =
+            table[i];
+    }
+
+    free(table);
+    table          = new_table;
+    table_capacity = new_capacity;
+}
+
+/**
+ * @return The slot holding name, inserting an entry without path if absent.
+ */
+static CommandEntry *insert_slot(const char *const name, const uint64_t hash) {
+    CommandEntry *entry = find_slot(table, table_capacity, name, hash);
+    if (entry->name != NULL) return entry;
+
+    // keep load factor below 3/4
+    if ((table_len + 1) * 4 > table_capacity * 3) {
+        grow_table();
+        entry = find_slot(table, table_capacity, name, hash);
+    }
+
+    *entry = (CommandEntry){.name = strdup(name), .path = NULL, .hash = hash};
+    table_len++;
+    return entry;
+}
+
+/**
+ * @brief Drop all entries if PATH has changed since they were resolved.
+ */
+static void check_path_env() {
+    const Variable *const var      = find_variable("PATH", strlen("PATH"));
+    const char           *path_env = var != NULL ? var->value : DEFAULT_PATH;
+
+    if (table_path_env != NULL && strcmp(table_path_env, path_env) == 0) {
+        return;
+    }
+
+    DEBUG_PRINT("DEBUG: PATH changed, command table cleared\n");
+    clear_command_table();
+    free(table_path_env);
+    table_path_env = strdup(path_env);
+}
+
+static bool is_executable_file(const char *const path) {
+    struct stat st;
+    if (stat(path, &st) == -1) return false;
+    return S_ISREG(st.st_mode) && access(path, X_OK) == 0;
+}
+
+/**
+ * @warning The caller is responsible for freeing the returned string.
+ */
+static char *search_path(const char *const name) {
+    const char *dir_begin = table_path_env;
+    const char *dir_end;
+    do {
+        dir_end = strchrnul(dir_begin, ':');
+
+        // an empty entry means the current directory
+        const int   dir_len = dir_end - dir_begin;
+        const char *dir     = dir_len == 0 ? "." : dir_begin;
+
+        char *path;
+        if (asprintf(&path, "%.*s/%s", dir_len == 0 ? 1 : dir_len, dir, name) ==
+            -1) {
+            return NULL;
+        }
+
+        if (is_executable_file(path)) return path;
+        free(path);
+
+        dir_begin = dir_end + 1;
+    } while (*dir_end != '\0');
+
+    return NULL;
+}
+
+static bool is_expired(const struct timespec *const expire) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec > expire->tv_sec ||
+           (now.tv_sec == expire->tv_sec && now.tv_nsec >= expire->tv_nsec);
+}
+
+const char *resolve_command(const char *const name) {
+    if (strchr(name, '/') != NULL) return name;
+
+    check_path_env();
+
+    CommandEntry *const entry = insert_slot(name, hash_str(name));
+
+    if (entry->path != NULL) {
+        // cached entry is valid while the executable exists
+        if (access(entry->path, X_OK) == 0) return entry->path;
+        DEBUG_PRINT("DEBUG: Cached command %s no longer exists\n", name);
+        free(entry->path);
+        entry->path = NULL;
+
+    } else if (entry->expire.tv_sec != 0 && !is_expired(&entry->expire)) {
+        return NULL;  // cached not-found entry
+    }
+
+    entry->path = search_path(name);
+    DEBUG_PRINT("DEBUG: Resolved command %s: %s\n", name,
+                entry->path != NULL ? entry->path : "(not found)");
+
+    if (entry->path == NULL) {
+        clock_gettime(CLOCK_MONOTONIC, &entry->expire);
+        entry->expire.tv_sec += NOT_FOUND_TTL_SEC;
+    }
+
+    return entry->path;
+}
+
+void add_command(const char *const name, const char *const path) {
+    check_path_env();
+
+    CommandEntry *const entry = insert_slot(name, hash_str(name));
+    free(entry->path);
+    entry->path = strdup(path);
+}
+
+const CommandEntry *read_command(const CommandEntry *const prev) {
+    const CommandEntry *curr = prev == NULL ? table : prev + 1;
+
+    const CommandEntry *const end = table + table_capacity;
+    // get the next found entry
+    while (curr < end && (curr->name == NULL || curr->path == NULL)) {
+        curr++;
+    }
+    if (curr == end) return NULL;
+
+    assert(curr->name != NULL);
+    assert(curr->path != NULL);
+
+    return curr;
+}
@@ -0,0 +1,52 @@
+#ifndef __COMMAND_TABLE_H__
+#define __COMMAND_TABLE_H__
+
+#include <stdint.h>
+#include <time.h>
+
+typedef struct {
+    char           *name;
+    char           *path;    // NULL if the command was not found
+    uint64_t        hash;
+    struct timespec expire;  // expiry of a not-found entry
+} CommandEntry;
+
+void init_command_table();
+
+void free_command_table();
+
+/**
+ * @brief Resolve a command name to the path of its executable.
+ *
+ * Names containing '/' are returned as is. Other names are searched in PATH
+ * and the result is cached. A cached entry is dropped when PATH changes or
+ * its executable no longer exists. A failed lookup is cached for a short
+ * time.
+ *
+ * @param [in] name The command name.
+ * @return The path of the executable, or NULL if the command was not found.
+ *
+ * @warning The returned string is owned by the table and is valid until the
+ * next call to any function of the table.
+ */
+const char *resolve_command(const char *name);
+
+/**
+ * @brief Add or replace the cached path of a command.
+ */
+void add_command(const char *name, const char *path);
+
+/**
+ * @brief Forget all cached commands.
+ */
+void clear_command_table();
+
+/**
+ * @brief Iterate over the cached commands which have been found.
+ *
+ * @param [in] prev The previous entry, or NULL to get the first entry.
+ * @return The next entry, or NULL if there are no more entries.
+ */
+const CommandEntry *read_command(const CommandEntry *prev);
+
+#endif
@@ -6,22 +6,42 @@
 #include <assert.h>
 #include <pthread.h>
 #include <signal.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <unistd.h>
 
+#include "background.h"
+#include "command_table.h"
 #include "io_helpers.h"
+#include "spawn.h"
+#include "variables.h"
 
 static pid_t exec_pid = 0;
 
+// Set by SIGINT while the shell runs a command
+static volatile sig_atomic_t sigint_received = false;
+
 static void send_sigint() {
+    sigint_received = true;
     if (exec_pid > 0) {
         kill(exec_pid, SIGINT);
     }
 }
 
-void exec_builtin(const builtin_fn fn, const size_t argc,
-                  char* const* const argv, const bool new_proc) {
+static void interrupt_builtin() {}
+
+static void interrupt_command() { sigint_received = true; }
+
+bool take_sigint() {
+    const bool received = sigint_received;
+    sigint_received     = false;
+    return received;
+}
+
+int exec_builtin(const builtin_fn fn, const size_t argc,
+                 char* const* const argv, const bool new_proc) {
     DEBUG_PRINT("DEBUG: Executing builtin: %s\n", argv[0]);
 
     if (!new_proc) {
@@ -30,19 +50,34 @@ void exec_builtin(const builtin_fn fn, const size_t argc,
         pthread_getname_np(pthread_self(), old_name, sizeof(old_name));
         pthread_setname_np(pthread_self(), argv[0]);
 
-        const RetVal retval = fn(argc, argv);
+        // let SIGINT interrupt blocking reads, e.g. cat from a terminal
+        struct sigaction old_sa;
+        struct sigaction sa = {
+            .sa_handler = interrupt_command,
+            .sa_flags   = 0,
+        };
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGINT, &sa, &old_sa);
+
+        const BuiltinIO io     = {.in_fd = STDIN_FILENO, .out = stdout};
+        const RetVal    retval = fn(argc, argv, &io);
         if (FAILED(retval)) {
             display_error("ERROR: Builtin failed: %s\n", argv[0]);
         }
 
+        // restore SIGINT handler
+        sigaction(SIGINT, &old_sa, NULL);
+
         // restore process name
         pthread_setname_np(pthread_self(), old_name);
 
+        return RETVAL_STATUS(retval);
+
     } else {
         exec_pid = fork();
         if (exec_pid == -1) {
             display_error("ERROR: Fork failed\n");
-            return;
+            return EXIT_FAILURE;
         }
 
         if (exec_pid) {
@@ -57,15 +92,14 @@ void exec_builtin(const builtin_fn fn, const size_t argc,
             sigemptyset(&sa.sa_mask);
             sigaction(SIGINT, &sa, &old_sa);
 
-            // wait for execution
-            int status;
-            do {
-                waitpid(exec_pid, &status, 0);
-            } while (!WIFEXITED(status) && !WIFSIGNALED(status));
+            // wait for execution, reaping exited jobs meanwhile
+            const int wstatus = wait_child(exec_pid);
 
             // restore SIGINT handler
             sigaction(SIGINT, &old_sa, NULL);
 
+            return exit_status(wstatus);
+
         } else {
             // execution process
 
@@ -81,62 +115,160 @@ void exec_builtin(const builtin_fn fn, const size_t argc,
             sigemptyset(&sa.sa_mask);
             sigaction(SIGINT, &sa, NULL);
 
-            const RetVal retval = fn(argc, argv);
+            const BuiltinIO io     = {.in_fd = STDIN_FILENO, .out = stdout};
+            const RetVal    retval = fn(argc, argv, &io);
             if (FAILED(retval)) {
                 display_error("ERROR: Builtin failed: %s\n", argv[0]);
-                exit(EXIT_FAILURE);
             }
-            exit(EXIT_SUCCESS);
+            exit(RETVAL_STATUS(retval));
         }
     }
 }
 
-void exec_executable(char* const* const argv, const bool new_proc) {
-    DEBUG_PRINT("DEBUG: Try executing executable: %s\n", argv[0]);
+static void* run_builtin_thread(void* const arg) {
+    BuiltinThread* const bt = arg;
 
-    if (!new_proc) {
-        if (execvp(argv[0], argv) == -1) {
-            display_error("ERROR: Unknown command: %s\n", argv[0]);
-            exit(EXIT_FAILURE);
-        }
-        assert(false);
+    pthread_setname_np(pthread_self(), bt->argv[0]);
 
-    } else {
-        exec_pid = fork();
-        if (exec_pid == -1) {
-            display_error("ERROR: Fork failed\n");
-            return;
-        }
+    // SIGINT is handled by the main thread, which interrupts this thread.
+    // Writing to a closed pipe fails with EPIPE instead of killing the shell.
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
 
-        if (exec_pid) {
-            // parent process
+    FILE* const out = fdopen(bt->out_fd, "w");
+    if (out == NULL) {
+        display_error("ERROR: Cannot open output: %s\n", bt->argv[0]);
+        close(bt->out_fd);
+        close(bt->in_fd);
+        sem_post(&bt->done);
+        return NULL;
+    }
 
-            // send SIGINT to child process
-            struct sigaction old_sa;
-            struct sigaction sa = {
-                .sa_handler = send_sigint,
-                .sa_flags   = 0,
-            };
-            sigemptyset(&sa.sa_mask);
-            sigaction(SIGINT, &sa, &old_sa);
+    const BuiltinIO io = {.in_fd = bt->in_fd, .out = out};
+    bt->retval         = bt->fn(bt->argc, bt->argv, &io);
+    if (FAILED(bt->retval)) {
+        display_error("ERROR: Builtin failed: %s\n", bt->argv[0]);
+    }
 
-            // wait for execution
-            int status;
-            do {
-                waitpid(exec_pid, &status, 0);
-            } while (!WIFEXITED(status) && !WIFSIGNALED(status));
+    // closing the fds lets the neighboring stages see EOF
+    fclose(out);
+    close(bt->in_fd);
 
-            // restore SIGINT handler
-            sigaction(SIGINT, &old_sa, NULL);
+    sem_post(&bt->done);
+    return NULL;
+}
 
-        } else {
-            // execution process
+bool start_builtin_thread(BuiltinThread* const bt) {
+    DEBUG_PRINT("DEBUG: Starting builtin thread: %s\n", bt->argv[0]);
 
-            if (execvp(argv[0], argv) == -1) {
-                display_error("ERROR: Unknown command: %s\n", argv[0]);
-                exit(EXIT_FAILURE);
-            }
-            assert(false);
-        }
+    // the signal interrupting builtin threads
+    struct sigaction sa = {
+        .sa_handler = interrupt_builtin,
+        .sa_flags   = 0,
+    };
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
+
+    sem_init(&bt->done, 0, 0);
+    bt->retval  = RETVAL_FAILURE;  // until the builtin returns
+    bt->started =
+        pthread_create(&bt->thread, NULL, run_builtin_thread, bt) == 0;
+    if (!bt->started) {
+        display_error("ERROR: Cannot start thread: %s\n", bt->argv[0]);
+        sem_destroy(&bt->done);
+        close(bt->out_fd);
+        close(bt->in_fd);
+    }
+    return bt->started;
+}
+
+void interrupt_builtin_thread(const BuiltinThread* const bt) {
+    if (bt->started) pthread_kill(bt->thread, SIGUSR1);
+}
+
+void wait_builtin_thread(BuiltinThread* const bt) {
+    if (!bt->started) return;
+
+    // sem_wait fails with EINTR when SIGINT is handled
+    while (sem_wait(&bt->done) == -1);
+}
+
+void join_builtin_thread(BuiltinThread* const bt) {
+    if (!bt->started) return;
+
+    // joining is not interruptible, and a joined thread cannot be signaled
+    pthread_join(bt->thread, NULL);
+    sem_destroy(&bt->done);
+    bt->started = false;
+}
+
+/**
+ * @brief Replace the current process with the executable at path.
+ * @note Never returns. The process exits if exec fails.
+ */
+static void exec_path(const char* const path, char* const* const argv) {
+    // the shell ignores SIGINT, which would otherwise be inherited
+    struct sigaction sa = {
+        .sa_handler = SIG_DFL,
+        .sa_flags   = 0,
+    };
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+
+    // the shell blocks SIGCHLD to receive it through a signalfd
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+
+    execve(path, argv, get_envp());
+    display_error("ERROR: Unknown command: %s\n", argv[0]);
+    exit(EXIT_FAILURE);
+}
+
+int exec_executable(char* const* const argv, const bool new_proc) {
+    DEBUG_PRINT("DEBUG: Try executing executable: %s\n", argv[0]);
+
+    // resolve in the main process, so that later commands reuse the cache
+    const char* const path = resolve_command(argv[0]);
+    if (path == NULL) {
+        display_error("ERROR: Unknown command: %s\n", argv[0]);
+        if (!new_proc) exit(STATUS_NOT_FOUND);
+        return STATUS_NOT_FOUND;
+    }
+
+    if (!new_proc) {
+        exec_path(path, argv);
+        assert(false);
+    }
+
+    const SpawnAttr attr = {
+        .stdin_fd  = SPAWN_FD_INHERIT,
+        .stdout_fd = SPAWN_FD_INHERIT,
+        .pgid      = SPAWN_PGID_INHERIT,
+    };
+    exec_pid = spawn_executable(path, argv, &attr);
+    if (exec_pid == -1) {
+        display_error("ERROR: Unknown command: %s\n", argv[0]);
+        return STATUS_NOT_FOUND;
     }
+
+    // send SIGINT to child process
+    struct sigaction old_sa;
+    struct sigaction sa = {
+        .sa_handler = send_sigint,
+        .sa_flags   = 0,
+    };
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, &old_sa);
+
+    // wait for execution, reaping exited jobs meanwhile
+    const int wstatus = wait_child(exec_pid);
+
+    // restore SIGINT handler
+    sigaction(SIGINT, &old_sa, NULL);
+
+    return exit_status(wstatus);
 }
@@ -1,14 +1,79 @@
 #ifndef __COMMANDS_H__
 #define __COMMANDS_H__
 
+#include <pthread.h>
+#include <semaphore.h>
 #include <stdbool.h>
 #include <stddef.h>
 
 #include "builtins.h"
 
-void exec_builtin(builtin_fn fn, size_t argc, char* const* const argv,
-                  bool new_proc);
+#define STATUS_NOT_FOUND 127  // exit status of an unknown command
 
-void exec_executable(char* const* argv, bool new_proc);
+/**
+ * A builtin running on a thread of the shell as a pipeline stage.
+ */
+typedef struct {
+    pthread_t    thread;
+    builtin_fn   fn;
+    size_t       argc;
+    char* const* argv;
+    int          in_fd;   // closed when the builtin returns
+    int          out_fd;  // closed when the builtin returns
+    RetVal       retval;  // valid after the thread is joined
+    bool         started;
+    sem_t        done;  // posted when the builtin returns
+} BuiltinThread;
+
+/**
+ * @brief Run a builtin in the shell process, or in a new process.
+ * @return The exit status of the builtin.
+ */
+int exec_builtin(builtin_fn fn, size_t argc, char* const* const argv,
+                 bool new_proc);
+
+/**
+ * @brief Start running a builtin on a new thread.
+ *
+ * The thread owns in_fd and out_fd, so the caller must not close them. On
+ * failure, they are closed immediately.
+ *
+ * @param [in,out] bt The builtin to run. It must stay valid until joined.
+ * @return true if the thread has started.
+ */
+bool start_builtin_thread(BuiltinThread* bt);
+
+/**
+ * @brief Interrupt the blocking calls of a builtin thread, like SIGINT does
+ * for a process.
+ * @note Async-signal-safe.
+ */
+void interrupt_builtin_thread(const BuiltinThread* bt);
+
+/**
+ * @brief Wait for the builtin of a thread to return. The thread can still be
+ * interrupted afterwards. Does nothing if it has not started.
+ */
+void wait_builtin_thread(BuiltinThread* bt);
+
+/**
+ * @brief Release a builtin thread after it has been waited for. It must not be
+ * interrupted any more.
+ */
+void join_builtin_thread(BuiltinThread* bt);
+
+/**
+ * @brief Check whether SIGINT has reached the shell while it ran a command
+ * since the last check.
+ */
+bool take_sigint();
+
+/**
+ * @brief Run an executable found in PATH in a new process and wait for it, or
+ * in place of the shell process.
+ * @return The exit status of the executable. Does not return if it runs in
+ * place of the shell.
+ */
+int exec_executable(char* const* argv, bool new_proc);
 
 #endif
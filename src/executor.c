@@ -0,0 +1,1279 @@
+#define _DEFAULT_SOURCE
+#define _GNU_SOURCE
+
+#include "executor.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "affinity.h"
+#include "background.h"
+#include "builtins.h"
+#include "command_table.h"
+#include "commands.h"
+#include "functions.h"
+#include "io_helpers.h"
+#include "redirect.h"
+#include "spawn.h"
+#include "variables.h"
+
+#define PIPE_SIZE_VAR      "MYSH_PIPE_SIZE"
+#define PIPE_MAX_SIZE_FILE "/proc/sys/fs/pipe-max-size"
+#define FIELD_SEPARATORS   " \t\n"  // split the words of a for loop
+#define EXIT_STATUS_USAGE  2         // exit status of a misused command
+#define MAX_FUNCTION_DEPTH 1000      // nested calls, before the stack runs out
+#define QUEUED_JOB_ARENA_SIZE 1024
+
+// Returned instead of 0 to unwind the statements being run
+#define STOP_EXIT   -1  // exit the shell
+#define STOP_RETURN -2  // return from the function
+
+/**
+ * The expanded command of a pipeline stage, with its redirections opened.
+ */
+typedef struct {
+    size_t       argc;
+    char *const *argv;
+    FdMapping   *mappings;
+    ssize_t      n_mapping;  // -1 if a redirection has failed
+    CpuPlacement placement;
+} Stage;
+
+/**
+ * A background pipeline waiting in the job queue. Its commands are expanded
+ * when it is queued, as they would be if it started at once.
+ */
+typedef struct {
+    Arena  arena;  // owns the stages
+    Stage *stages;
+    size_t n_stage;
+    int    out_fd;  // stdout and stderr of the shell when queued
+    int    err_fd;
+} QueuedJob;
+
+static pid_t executing_pgid = -1;
+
+static const BuiltinThread *executing_threads   = NULL;
+static size_t               n_executing_threads = 0;
+
+// Set by SIGINT, which stops the rest of the line
+static volatile sig_atomic_t line_interrupted = false;
+
+// The number of function calls being run
+static size_t function_depth = 0;
+
+static void interrupt_line() { line_interrupted = true; }
+
+static void sigint_executing_processes() {
+    line_interrupted = true;
+
+    for (size_t i = 0; i < n_executing_threads; i++) {
+        interrupt_builtin_thread(&executing_threads[i]);
+    }
+
+    if (executing_pgid == -1) return;
+
+    if (killpg(executing_pgid, SIGINT) == -1) {
+        display_error("ERROR: Failed to send SIGINT to executing processes\n");
+    }
+}
+
+/**
+ * @brief Wait for a child process of the shell running part of the line, which
+ * SIGINT stops along with the rest of the line.
+ *
+ * @return The exit status of the child.
+ */
+static int wait_isolated(const pid_t pid) {
+    struct sigaction old_sa;
+    struct sigaction sa = {
+        .sa_handler = interrupt_line,
+        .sa_flags   = 0,
+    };
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, &old_sa);
+
+    const int wstatus = wait_child(pid);
+
+    sigaction(SIGINT, &old_sa, NULL);
+    return exit_status(wstatus);
+}
+
+/**
+ * @return The exit status of the command.
+ */
+static int exec(const size_t argc, char *const *const argv,
+                const bool background) {
+    assert(argv[argc] == NULL);  // argv should be NULL-terminated
+
+    // Check for assignment
+    if (argc == 1) {
+        if (exec_assignment(argv[0])) {
+            return EXIT_SUCCESS;
+        }
+    }
+
+    // Check for builtins
+    if (argc >= 1) {
+        const Builtin *builtin = check_builtin(argv[0]);
+        if (builtin != NULL) {
+            // execute builtin in new process if both:
+            // 1. it is not a builtin which should run in foreground
+            // 2. we are not already running in background
+            const bool new_proc = !builtin->foreground && !background;
+
+            return exec_builtin(builtin->fn, argc, argv, new_proc);
+        }
+    }
+
+    // Check for executable
+    return exec_executable(argv, !background);
+}
+
+/**
+ * @return The requested size of pipeline pipes in bytes, or 0 to keep the
+ * default. Set by the MYSH_PIPE_SIZE variable, which may come from the
+ * environment, with an optional K or M suffix.
+ */
+static size_t requested_pipe_size() {
+    const Variable *const var =
+        find_variable(PIPE_SIZE_VAR, strlen(PIPE_SIZE_VAR));
+    if (var == NULL || var->value_len == 0) return 0;
+
+    const char *const value = var->value;
+
+    char         *end;
+    unsigned long size = strtoul(value, &end, 10);
+    if (*end == 'K' || *end == 'k') {
+        size <<= 10;
+        end++;
+    } else if (*end == 'M' || *end == 'm') {
+        size <<= 20;
+        end++;
+    }
+
+    if (*end != '\0' || value[0] == '-') {
+        display_error("ERROR: Invalid %s: %s\n", PIPE_SIZE_VAR, value);
+        return 0;
+    }
+    return size;
+}
+
+/**
+ * @return The maximum pipe size unprivileged processes may set.
+ */
+static size_t max_pipe_size() {
+    static size_t max_size = 0;  // read once
+
+    if (max_size == 0) {
+        FILE *const file = fopen(PIPE_MAX_SIZE_FILE, "re");
+        if (file == NULL || fscanf(file, "%zu", &max_size) != 1) {
+            max_size = SIZE_MAX;  // let the kernel decide
+        }
+        if (file != NULL) fclose(file);
+    }
+    return max_size;
+}
+
+/**
+ * @brief Resize the buffer of a pipe, up to the system maximum.
+ */
+static void resize_pipe(const int fd, size_t size) {
+    if (size > max_pipe_size()) size = max_pipe_size();
+    if (size > INT_MAX) size = INT_MAX;
+
+    const int actual = fcntl(fd, F_SETPIPE_SZ, (int)size);
+    if (actual == -1) {
+        display_error("ERROR: Cannot set pipe size to %zu\n", size);
+        return;
+    }
+    DEBUG_PRINT("DEBUG: Pipe size: %d\n", actual);
+}
+
+/**
+ * @brief Expand the words of a command into arguments.
+ *
+ * @param command [in] The command to expand.
+ * @param arena [in] Arena owning the arguments.
+ * @param argv [out] Receives the arguments without leading empty words,
+ * terminated by NULL.
+ * @return the number of arguments in argv, or -1 if the expansion has failed.
+ */
+static ssize_t expand_command(const Command *const command, Arena *const arena,
+                              char *const **const argv) {
+    char **const args =
+        arena_alloc(arena, (command->n_word + 1) * sizeof(char *));
+
+    size_t argc = 0;
+    for (size_t i = 0; i < command->n_word; i++) {
+        char *const arg = expand_word(&command->words[i], arena);
+        if (arg == NULL) return -1;
+
+        // Drop leading empty words
+        if (argc == 0 && arg[0] == '\0') continue;
+
+        args[argc++] = arg;
+    }
+    args[argc] = NULL;
+
+    DEBUG_PRINT("DEBUG: Expanded arguments: [");
+    for (size_t i = 0; i < argc; i++) {
+        DEBUG_PRINT("%s", args[i]);
+        if (i < argc - 1) {
+            DEBUG_PRINT(", ");
+        }
+    }
+    DEBUG_PRINT("]\n");
+
+    *argv = args;
+    return argc;
+}
+
+/**
+ * @brief Set the exit status for exit [n] or return [n].
+ */
+static void set_exit_code(const size_t argc, char *const *const argv) {
+    if (argc < 2) return;  // the status of the last command
+
+    char      *end;
+    const long code = strtol(argv[1], &end, 10);
+    if (argv[1][0] == '\0' || *end != '\0') {
+        display_error("ERROR: %s: Invalid number: %s\n", argv[0], argv[1]);
+        set_exit_status(EXIT_STATUS_USAGE);
+        return;
+    }
+    set_exit_status(code & 0xff);
+}
+
+static int run_block(const Block *block, Arena *arena, bool batch,
+                     bool subshell);
+
+/**
+ * @brief Set the positional parameters $1, $2, ..., $# and $@ of a function
+ * call as locals of its frame. Those of the caller beyond the arguments are
+ * unset.
+ */
+static void set_positional(const size_t argc, char *const *const argv,
+                           Arena *const arena) {
+    const Variable *const count = find_variable("#", 1);
+    const size_t          n_outer =
+        count != NULL ? strtoul(count->value, NULL, 10) : 0;
+
+    size_t all_len = 0;
+    for (size_t i = 1; i < argc || i <= n_outer; i++) {
+        char      name[24];
+        const int name_len = snprintf(name, sizeof(name), "%zu", i);
+        if (i < argc) {
+            const size_t len  = strlen(argv[i]);
+            all_len          += len + 1;
+            set_local(name, name_len, argv[i], len);
+        } else {
+            set_local(name, name_len, NULL, 0);
+        }
+    }
+
+    char      digits[24];
+    const int n_digit = snprintf(digits, sizeof(digits), "%zu", argc - 1);
+    set_local("#", 1, digits, n_digit);
+
+    // $@ joins the arguments with spaces
+    char *const all = arena_alloc(arena, all_len + 1);
+    size_t      len = 0;
+    for (size_t i = 1; i < argc; i++) {
+        if (i > 1) all[len++] = ' ';
+        const size_t arg_len = strlen(argv[i]);
+        memcpy(all + len, argv[i], arg_len);
+        len += arg_len;
+    }
+    set_local("@", 1, all, len);
+}
+
+/**
+ * @brief Run the body of a function in the shell process, with a new frame
+ * for its locals.
+ *
+ * @return The exit status of the function, or STOP_EXIT
+ */
+static int call_function(Function *const function, const size_t argc,
+                         char *const *const argv, Arena *const arena) {
+    if (function_depth == MAX_FUNCTION_DEPTH) {
+        display_error("ERROR: %s: Maximum function depth exceeded\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    push_frame();
+    set_positional(argc, argv, arena);
+
+    hold_function(function);
+    function_depth++;
+    const int ret = run_block(function->body, arena, false, false);
+    function_depth--;
+    release_function(function);
+
+    pop_frame();
+
+    // return has set the status
+    return ret == STOP_EXIT ? STOP_EXIT : get_exit_status();
+}
+
+/**
+ * @return The exit status of the command, STOP_EXIT or STOP_RETURN
+ */
+static int run_command(const size_t argc, char *const *const argv,
+                       const bool background, Arena *const arena) {
+    // Skip empty line
+    if (argc == 0) return EXIT_SUCCESS;
+
+    // Exit
+    if (strcmp("exit", argv[0]) == 0) {
+        set_exit_code(argc, argv);
+        return STOP_EXIT;
+    }
+
+    // Return from a function
+    if (strcmp("return", argv[0]) == 0) {
+        if (function_depth == 0) {
+            display_error("ERROR: return: Not in a function\n");
+            return EXIT_FAILURE;
+        }
+        set_exit_code(argc, argv);
+        return STOP_RETURN;
+    }
+
+    // Functions come before builtins and executables
+    Function *const function = find_function(argv[0]);
+    if (function != NULL) return call_function(function, argc, argv, arena);
+
+    return exec(argc, argv, background);
+}
+
+/**
+ * @brief Run a command in a forked child process of the shell, and set $? to
+ * the status the child exits with.
+ */
+static void run_in_child(const size_t argc, char *const *const argv,
+                         const FdMapping *const mappings,
+                         const size_t n_mapping, Arena *const arena) {
+    const int status = apply_redirects(mappings, n_mapping)
+                           ? run_command(argc, argv, true, arena)
+                           : EXIT_FAILURE;
+
+    // exit and return have set the status
+    if (status >= 0) set_exit_status(status);
+}
+
+/**
+ * @return The builtin if the command can run on a thread of the shell, or NULL
+ * if it needs a process.
+ */
+static const Builtin *threaded_builtin(const size_t argc,
+                                       char *const *const argv) {
+    if (argc == 0) return NULL;
+    if (argc == 1 && is_assignment(argv[0])) return NULL;
+    if (find_function(argv[0]) != NULL) return NULL;
+
+    const Builtin *const builtin = check_builtin(argv[0]);
+    if (builtin == NULL || !builtin->threaded) return NULL;
+    return builtin;
+}
+
+/**
+ * @return Whether a builtin thread can take the redirections in place of its
+ * pipe ends: only files redirected to stdin or stdout.
+ */
+static bool threadable_redirects(const FdMapping *const mappings,
+                                 const size_t n_mapping) {
+    for (size_t i = 0; i < n_mapping; i++) {
+        if (!mappings[i].owned) return false;
+        if (mappings[i].fd != STDIN_FILENO && mappings[i].fd != STDOUT_FILENO) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Run a command in the shell process with its redirections applied to
+ * the fds of the shell for the duration of the command.
+ *
+ * @return The exit status of the command, STOP_EXIT or STOP_RETURN
+ */
+static int run_redirected(const size_t argc, char *const *const argv,
+                          const FdMapping *const mappings,
+                          const size_t n_mapping, Arena *const arena,
+                          const bool last) {
+    if (n_mapping == 0) return run_command(argc, argv, last, arena);
+
+    int *const saved = arena_alloc(arena, n_mapping * sizeof(int));
+    fflush(stdout);
+    if (!save_redirects(mappings, n_mapping, saved)) return EXIT_FAILURE;
+
+    const int ret = run_command(argc, argv, last, arena);
+
+    fflush(stdout);
+    fflush(stderr);
+    restore_redirects(mappings, n_mapping, saved);
+    return ret;
+}
+
+/**
+ * @return The path of the executable if the command can be spawned without
+ * forking the shell, or NULL if it has to run in a forked shell process.
+ */
+static const char *spawnable_path(const size_t argc, char *const *const argv) {
+    if (argc == 0) return NULL;
+    if (argc == 1 && is_assignment(argv[0])) return NULL;
+    if (strcmp("exit", argv[0]) == 0) return NULL;
+    if (find_function(argv[0]) != NULL) return NULL;
+    if (check_builtin(argv[0]) != NULL) return NULL;
+    return resolve_command(argv[0]);
+}
+
+/**
+ * @return Whether the command changes the state of the shell, or may do so:
+ * assignments, builtins which do not run on threads, exit, and unknown
+ * commands.
+ */
+static bool changes_shell(const size_t argc, char *const *const argv) {
+    return argc > 0 && threaded_builtin(argc, argv) == NULL &&
+           spawnable_path(argc, argv) == NULL;
+}
+
+/**
+ * @brief Run a command in a child process of the shell and wait for it, so
+ * that it cannot change the state of the shell.
+ *
+ * @return The exit status of the command.
+ */
+static int run_isolated(const size_t argc, char *const *const argv,
+                        const FdMapping *const mappings,
+                        const size_t n_mapping, Arena *const arena) {
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == -1) {
+        display_error("ERROR: Fork failed\n");
+        return EXIT_FAILURE;
+    }
+
+    if (pid == 0) {
+        run_in_child(argc, argv, mappings, n_mapping, arena);
+        fflush(stdout);
+        _exit(get_exit_status());
+    }
+
+    return wait_isolated(pid);
+}
+
+/**
+ * @brief Expand the commands of a pipeline and open their redirections.
+ *
+ * @param [in] out_fd The stdout of the last stage unless redirected, or -1
+ * to keep the one of the shell.
+ * @param [in] err_fd The stderr of the stages unless redirected, or -1 to keep
+ * the one of the shell.
+ */
+static Stage *prepare_stages(const Pipeline *const pipeline,
+                             char *const *const heredocs, const int out_fd,
+                             const int err_fd, Arena *const arena) {
+    const size_t n_stage = pipeline->n_command;
+    Stage *const stages  = arena_alloc(arena, n_stage * sizeof(Stage));
+
+    CpuPlacement placement;
+    requested_placement(&placement);
+
+    for (size_t i = 0; i < n_stage; i++) {
+        Stage *const         stage   = &stages[i];
+        const Command *const command = &pipeline->commands[i];
+        const ssize_t n_arg = expand_command(command, arena, &stage->argv);
+        stage->argc         = n_arg == -1 ? 0 : n_arg;
+        stage->placement    = placement;
+        if (n_arg == -1 ||
+            !take_pin_prefix(&stage->argc, &stage->argv, &stage->placement)) {
+            stage->n_mapping = -1;
+            continue;
+        }
+        stage->n_mapping =
+            open_redirects(command, heredocs, arena, &stage->mappings);
+        if (stage->n_mapping == -1) continue;
+
+        // applied before the redirections of the command, which override them
+        FdMapping defaults[2];
+        size_t    n_default = 0;
+        if (err_fd != -1) {
+            defaults[n_default++] =
+                (FdMapping){.fd = STDERR_FILENO, .source = err_fd};
+        }
+        if (out_fd != -1 && i == n_stage - 1) {
+            defaults[n_default++] =
+                (FdMapping){.fd = STDOUT_FILENO, .source = out_fd};
+        }
+        if (n_default == 0) continue;
+
+        FdMapping *const mappings = arena_alloc(
+            arena, (n_default + stage->n_mapping) * sizeof(FdMapping));
+        memcpy(mappings, defaults, n_default * sizeof(FdMapping));
+        memcpy(mappings + n_default, stage->mappings,
+               stage->n_mapping * sizeof(FdMapping));
+        stage->mappings   = mappings;
+        stage->n_mapping += n_default;
+    }
+    return stages;
+}
+
+static void close_stages(const Stage *const stages, const size_t n_stage) {
+    for (size_t i = 0; i < n_stage; i++) {
+        if (stages[i].n_mapping != -1) {
+            close_redirects(stages[i].mappings, stages[i].n_mapping);
+        }
+    }
+}
+
+/**
+ * The fds a stage of a pipeline starts with.
+ */
+typedef struct {
+    int in_fd;    // stdin, or SPAWN_FD_CLOSE
+    int out_fd;   // stdout, or SPAWN_FD_INHERIT
+    int next_fd;  // read end of the pipe from out_fd, or -1 for the last stage
+} StageFds;
+
+/**
+ * @brief Create the pipe from a stage to the next one, with the requested
+ * buffer size.
+ *
+ * @return false on error, which is displayed.
+ */
+static bool open_stage_pipe(int pipe_fd[2], const size_t pipe_size) {
+    if (pipe2(pipe_fd, O_CLOEXEC) == -1) {
+        display_error("ERROR: Pipe failed\n");
+        return false;
+    }
+    DEBUG_PRINT("DEBUG: Pipe created: %d %d\n", pipe_fd[0], pipe_fd[1]);
+    if (pipe_size > 0) resize_pipe(pipe_fd[1], pipe_size);
+    return true;
+}
+
+/**
+ * @brief Start the process of a pipeline stage. An executable is spawned, and
+ * other commands run in a forked child of the shell, which exits after them.
+ * The redirections of the stage are closed in the shell afterwards, but not
+ * the fds.
+ *
+ * @param [in] i_stage The index of the stage, for its CPU placement.
+ * @param [in,out] pgid The process group to join, or SPAWN_PGID_*.
+ * SPAWN_PGID_NEW is replaced by the pid of the new process.
+ * @param [in,out] binding The CPUs of the shell thread while the pipeline
+ * starts.
+ * @return The pid of the process, or -1 on error, which is displayed.
+ */
+static pid_t start_stage(const Stage *const stage, const size_t i_stage,
+                         const StageFds *const fds, pid_t *const pgid,
+                         CpuBinding *const binding, Arena *const arena) {
+    bind_stage(&stage->placement, i_stage, binding);
+
+    pid_t             pid  = -1;
+    const char *const path = spawnable_path(stage->argc, stage->argv);
+    if (path != NULL) {
+        const SpawnAttr attr = {
+            .stdin_fd  = fds->in_fd,
+            .stdout_fd = fds->out_fd,
+            .pgid      = *pgid,
+            .mappings  = stage->mappings,
+            .n_mapping = stage->n_mapping,
+        };
+        pid = spawn_executable(path, stage->argv, &attr);
+    }
+
+    // fall back to fork for builtins or if spawn failed
+    if (pid == -1) {
+        fflush(stdout);
+        pid = fork();
+    }
+    if (pid == 0) {
+        if (*pgid != SPAWN_PGID_INHERIT) setpgid(0, *pgid);
+
+        if (fds->in_fd == SPAWN_FD_CLOSE) {
+            close(STDIN_FILENO);
+        } else {
+            dup2(fds->in_fd, STDIN_FILENO);
+            close(fds->in_fd);
+        }
+        if (fds->out_fd != SPAWN_FD_INHERIT) {
+            dup2(fds->out_fd, STDOUT_FILENO);
+            close(fds->out_fd);
+        }
+        if (fds->next_fd != -1) close(fds->next_fd);
+
+        // only the output of the last stage is read by a user
+        setvbuf(stdout, NULL, fds->next_fd == -1 ? _IOLBF : _IOFBF, 0);
+
+        // the shell may be in a loop, a command substitution or a wait here,
+        // so never return
+        run_in_child(stage->argc, stage->argv, stage->mappings,
+                     stage->n_mapping, arena);
+        fflush(stdout);
+        _exit(get_exit_status());
+    }
+    close_redirects(stage->mappings, stage->n_mapping);
+
+    if (pid == -1) {
+        display_error("ERROR: Fork failed\n");
+        return -1;
+    }
+    DEBUG_PRINT("DEBUG: New process started, pid: %d\n", pid);
+
+    // also set pgid here to avoid racing with the next stage
+    if (*pgid == SPAWN_PGID_NEW) *pgid = pid;
+    if (*pgid != SPAWN_PGID_INHERIT) setpgid(pid, *pgid);
+    return pid;
+}
+
+/**
+ * @brief Start the stages of a background pipeline, with stdin closed. The
+ * redirections of the stages are closed afterwards.
+ *
+ * @param [out] pids Receives the pids of the started processes.
+ * @return The number of processes started.
+ */
+static size_t start_stages(const Stage *const stages, const size_t n_stage,
+                           pid_t *const pids, Arena *const arena) {
+    const size_t pipe_size = requested_pipe_size();
+
+    // a pipeline runs in a new process group, a single command does not
+    pid_t      pgid      = n_stage > 1 ? SPAWN_PGID_NEW : SPAWN_PGID_INHERIT;
+    size_t     n_spawned = 0;
+    int        in_fd     = SPAWN_FD_CLOSE;  // pipe from the previous stage
+    CpuBinding binding   = {.bound = false};
+    for (size_t i = 0; i < n_stage; i++) {
+        const bool last = i == n_stage - 1;
+
+        int pipe_fd[2] = {-1, -1};
+        if (!last && !open_stage_pipe(pipe_fd, pipe_size)) {
+            close_stages(stages + i, n_stage - i);
+            break;
+        }
+
+        // a stage whose expansion or redirections have failed does not run
+        if (stages[i].n_mapping != -1) {
+            const StageFds fds = {
+                .in_fd   = in_fd,
+                .out_fd  = last ? SPAWN_FD_INHERIT : pipe_fd[1],
+                .next_fd = pipe_fd[0],
+            };
+            const pid_t pid =
+                start_stage(&stages[i], i, &fds, &pgid, &binding, arena);
+            if (pid != -1) pids[n_spawned++] = pid;
+        }
+
+        if (in_fd >= 0) close(in_fd);
+        if (pipe_fd[1] != -1) close(pipe_fd[1]);
+        in_fd = pipe_fd[0];
+    }
+    if (in_fd >= 0) close(in_fd);
+    unbind_stages(&binding);
+
+    return n_spawned;
+}
+
+static void free_queued_job(QueuedJob *const job) {
+    close(job->out_fd);
+    close(job->err_fd);
+    arena_free(&job->arena);
+    free(job);
+}
+
+static size_t start_queued_job(void *const spec, pid_t *const pids) {
+    QueuedJob *const job = spec;
+    const size_t     n_spawned =
+        start_stages(job->stages, job->n_stage, pids, &job->arena);
+    free_queued_job(job);
+    return n_spawned;
+}
+
+static void release_queued_job(void *const spec) {
+    QueuedJob *const job = spec;
+    close_stages(job->stages, job->n_stage);
+    free_queued_job(job);
+}
+
+static const JobLauncher QUEUED_JOB_LAUNCHER = {
+    .start   = start_queued_job,
+    .release = release_queued_job,
+};
+
+/**
+ * @brief Start a background pipeline, or queue it while the maximum number
+ * of jobs are running.
+ *
+ * @return The exit status, which fails only if no process has started.
+ */
+static int run_background(const Pipeline *const pipeline,
+                          char *const *const heredocs, Arena *const arena) {
+    const size_t n_stage = pipeline->n_command;
+
+    if (!can_start_job()) {
+        // the job writes where the shell writes now, even if it starts while
+        // a builtin has redirected the shell
+        QueuedJob *const job = malloc(sizeof(QueuedJob));
+        arena_init(&job->arena, QUEUED_JOB_ARENA_SIZE);
+        job->out_fd  = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0);
+        job->err_fd  = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, 0);
+        job->n_stage = n_stage;
+        job->stages  = prepare_stages(pipeline, heredocs, job->out_fd,
+                                      job->err_fd, &job->arena);
+
+        queue_background_job(n_stage, pipeline->text, &QUEUED_JOB_LAUNCHER,
+                             job);
+        return EXIT_SUCCESS;
+    }
+
+    const Stage *const stages =
+        prepare_stages(pipeline, heredocs, -1, -1, arena);
+    pid_t *const pids      = arena_alloc(arena, n_stage * sizeof(pid_t));
+    const size_t n_spawned = start_stages(stages, n_stage, pids, arena);
+    if (n_spawned == 0) return EXIT_FAILURE;
+
+    add_background_job(pids, n_spawned, pipeline->text);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Run a pipeline, and set $? to the exit status of its last command.
+ *
+ * @param [in] subshell Whether the pipeline must not change the state of the
+ * shell, like in a command substitution.
+ * @return 0 on continue, STOP_EXIT or STOP_RETURN
+ */
+static int run_pipeline(const Pipeline *const pipeline, Arena *const arena,
+                        const bool batch, const bool subshell) {
+    const size_t n_command = pipeline->n_command;
+    const bool   bg        = pipeline->background;
+
+    DEBUG_PRINT("DEBUG: Command count: %zu, background: %d\n", n_command, bg);
+
+    // Skip empty line
+    if (n_command == 0) return 0;
+
+    // heredoc bodies follow the line in the input
+    char *const *const heredocs = read_heredocs(pipeline, arena);
+
+    if (bg) {
+        set_exit_status(run_background(pipeline, heredocs, arena));
+        return 0;
+    }
+
+    bool exit     = false;
+    bool returned = false;  // from the function running the pipeline
+
+    if (n_command == 1) {
+        // single command
+        char *const  *argv;
+        const ssize_t n_arg =
+            expand_command(&pipeline->commands[0], arena, &argv);
+        if (n_arg == -1) {
+            set_exit_status(EXIT_FAILURE);
+            return 0;
+        }
+        size_t argc = n_arg;
+
+        // an assignment runs nothing, and may be the one fixing MYSH_CPUSET
+        CpuPlacement placement = {.n_cpu = 0};
+        if (argc != 1 || !is_assignment(argv[0])) {
+            requested_placement(&placement);
+        }
+        if (!take_pin_prefix(&argc, &argv, &placement)) {
+            set_exit_status(EXIT_STATUS_USAGE);
+            return 0;
+        }
+
+        FdMapping    *mappings;
+        const ssize_t n_mapping =
+            open_redirects(&pipeline->commands[0], heredocs, arena,
+                           &mappings);
+        if (n_mapping == -1) {
+            set_exit_status(EXIT_FAILURE);
+            return 0;
+        }
+
+        // the last command of a script runs in place of the shell
+        // instead of spawning a new process. Checked after expansion,
+        // since reading ahead invalidates the line.
+        const bool last =
+            batch && read_job(NULL) == NULL && input_at_eof();
+        if (last) fflush(stdout);
+
+        // run in foreground, with the shell on the CPUs of the command
+        // until it returns
+        CpuBinding binding = {.bound = false};
+        bind_stage(&placement, 0, &binding);
+        const int status =
+            subshell && changes_shell(argc, argv)
+                ? run_isolated(argc, argv, mappings, n_mapping, arena)
+                : run_redirected(argc, argv, mappings, n_mapping, arena,
+                                 last);
+        unbind_stages(&binding);
+        if (status == STOP_EXIT) {
+            exit = true;
+        } else if (status == STOP_RETURN) {
+            returned = true;
+        } else {
+            set_exit_status(status);
+        }
+        close_redirects(mappings, n_mapping);
+
+    } else {
+        // pipe
+        const Stage *const stages =
+            prepare_stages(pipeline, heredocs, -1, -1, arena);
+
+        pid_t *pids      = arena_alloc(arena, n_command * sizeof(*pids));
+        size_t n_spawned = 0;
+        pid_t  pgid      = SPAWN_PGID_NEW;
+
+        const size_t pipe_size = requested_pipe_size();
+        CpuBinding   binding   = {.bound = false};
+
+        // builtin stages of a foreground pipeline run on threads, which are
+        // started after all processes are forked
+        BuiltinThread *threads =
+            arena_alloc(arena, n_command * sizeof(*threads));
+        size_t *thread_stages =
+            arena_alloc(arena, n_command * sizeof(*thread_stages));
+        size_t n_thread = 0;
+
+        // the exit status of the pipeline is the one of the last stage
+        const BuiltinThread *last_thread  = NULL;
+        bool                 last_spawned = false;
+        int                  status       = EXIT_FAILURE;
+
+        // close-on-exec, so that spawned processes only inherit the fds
+        // they are redirected to
+        int in_fd = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 0);
+
+        for (size_t i = 0; i < n_command; i++) {
+            DEBUG_PRINT("DEBUG: Executing command %zu\n", i);
+
+            const Stage *const stage = &stages[i];
+            const bool         last  = i == n_command - 1;
+
+            int pipe_fd[2] = {-1, -1};
+            if (!last && !open_stage_pipe(pipe_fd, pipe_size)) {
+                close_stages(stages + i, n_command - i);
+                break;
+            }
+            const int out_fd =
+                last ? fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0) : pipe_fd[1];
+
+            // a stage whose expansion or redirections have failed does not
+            // run
+            const Builtin *const builtin =
+                stage->n_mapping != -1 &&
+                        threadable_redirects(stage->mappings, stage->n_mapping)
+                    ? threaded_builtin(stage->argc, stage->argv)
+                    : NULL;
+            if (builtin != NULL) {
+                // the thread takes over both ends, or the redirected files
+                // in their place
+                BuiltinThread thread = {
+                    .fn     = builtin->fn,
+                    .argc   = stage->argc,
+                    .argv   = stage->argv,
+                    .in_fd  = in_fd,
+                    .out_fd = out_fd,
+                };
+                for (ssize_t j = 0; j < stage->n_mapping; j++) {
+                    int *const end = stage->mappings[j].fd == STDIN_FILENO
+                                         ? &thread.in_fd
+                                         : &thread.out_fd;
+                    close(*end);
+                    *end = stage->mappings[j].source;
+                }
+                if (last) last_thread = &threads[n_thread];
+                thread_stages[n_thread] = i;
+                threads[n_thread++]     = thread;
+            } else {
+                if (stage->n_mapping != -1) {
+                    const StageFds fds = {
+                        .in_fd   = in_fd,
+                        .out_fd  = out_fd,
+                        .next_fd = pipe_fd[0],
+                    };
+                    const pid_t pid =
+                        start_stage(stage, i, &fds, &pgid, &binding, arena);
+                    if (pid != -1) {
+                        pids[n_spawned++] = pid;
+                        if (last) last_spawned = true;
+                    }
+                }
+                close(in_fd);
+                close(out_fd);
+            }
+            in_fd = pipe_fd[0];
+        }  // for commands
+        if (in_fd != -1) close(in_fd);
+        unbind_stages(&binding);
+
+        // threads inherit the CPUs of the shell thread, which gets back its
+        // own CPUs for a stage without placement
+        if (n_thread > 0) hold_job_dispatch();
+        for (size_t i = 0; i < n_thread; i++) {
+            bind_stage(&stages[thread_stages[i]].placement, thread_stages[i],
+                       &binding);
+            start_builtin_thread(&threads[i]);
+        }
+        unbind_stages(&binding);
+
+        // handle SIGINT
+        executing_pgid      = n_spawned > 0 ? pgid : -1;
+        executing_threads   = threads;
+        n_executing_threads = n_thread;
+        struct sigaction old_sa;
+        struct sigaction sa = {
+            .sa_handler = sigint_executing_processes,
+            .sa_flags   = 0,
+        };
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGINT, &sa, &old_sa);
+
+        // wait for the processes and threads of this pipeline only
+        const int wstatus = wait_children(pids, n_spawned);
+        for (size_t i = 0; i < n_thread; i++) {
+            wait_builtin_thread(&threads[i]);
+        }
+
+        // restore SIGINT handler
+        sigaction(SIGINT, &old_sa, NULL);
+        executing_pgid      = -1;
+        n_executing_threads = 0;
+        executing_threads   = NULL;
+
+        for (size_t i = 0; i < n_thread; i++) {
+            join_builtin_thread(&threads[i]);
+        }
+        if (n_thread > 0) release_job_dispatch();
+
+        if (last_thread != NULL) {
+            status = RETVAL_STATUS(last_thread->retval);
+        } else if (last_spawned) {
+            status = exit_status(wstatus);
+        }
+        set_exit_status(status);
+
+    }  // if n_command == 1
+
+    return exit ? STOP_EXIT : returned ? STOP_RETURN : 0;
+}
+
+/**
+ * @return Whether SIGINT has reached the shell since the line started, while
+ * it ran a loop, a pipeline or a command. A command merely exiting with the
+ * status of SIGINT does not stop the line.
+ */
+static bool interrupted() {
+    if (take_sigint()) line_interrupted = true;
+    return line_interrupted;
+}
+
+/**
+ * @brief Run the body of the first clause whose condition succeeds, or the
+ * else body.
+ */
+static int run_if(const Statement *const statement, Arena *const arena,
+                  const bool subshell) {
+    for (size_t i = 0; i < statement->n_branch; i++) {
+        const Clause *const branch = &statement->branches[i];
+        const int ret = run_block(&branch->condition, arena, false, subshell);
+        if (ret != 0) return ret;
+        if (get_exit_status() == EXIT_SUCCESS) {
+            return run_block(&branch->body, arena, false, subshell);
+        }
+    }
+
+    if (statement->otherwise.n_statement > 0) {
+        return run_block(&statement->otherwise, arena, false, subshell);
+    }
+
+    // no body has run
+    set_exit_status(EXIT_SUCCESS);
+    return 0;
+}
+
+/**
+ * @brief Run the body of a loop while its condition succeeds.
+ */
+static int run_while(const Clause *const loop, Arena *const arena,
+                     const bool subshell) {
+    int status = EXIT_SUCCESS;  // of the last body
+
+    // an iteration releases the memory of the previous one, so a loop runs in
+    // constant memory
+    const ArenaMark mark = arena_mark(arena);
+    while (true) {
+        arena_rewind(arena, mark);
+
+        int ret = run_block(&loop->condition, arena, false, subshell);
+        if (ret != 0) return ret;
+        if (get_exit_status() != EXIT_SUCCESS || interrupted()) break;
+
+        ret = run_block(&loop->body, arena, false, subshell);
+        if (ret != 0) return ret;
+        status = get_exit_status();
+        if (interrupted()) break;
+    }
+
+    set_exit_status(status);
+    return 0;
+}
+
+/**
+ * @brief Run the body of a loop for each field of the expanded words.
+ */
+static int run_for(const Statement *const statement, Arena *const arena,
+                   const bool subshell) {
+    int status = EXIT_SUCCESS;  // of the last body
+
+    const ArenaMark word_mark = arena_mark(arena);
+    for (size_t i = 0; i < statement->n_word; i++) {
+        arena_rewind(arena, word_mark);
+
+        // the fields are split in place
+        char *field = expand_word(&statement->words[i], arena);
+        if (field == NULL) {
+            set_exit_status(EXIT_FAILURE);
+            return 0;
+        }
+        field += strspn(field, FIELD_SEPARATORS);
+
+        const ArenaMark mark = arena_mark(arena);
+        while (*field != '\0') {
+            char *next = field + strcspn(field, FIELD_SEPARATORS);
+            if (*next != '\0') *next++ = '\0';
+            next += strspn(next, FIELD_SEPARATORS);
+
+            arena_rewind(arena, mark);
+            set_variable(statement->variable, field);
+
+            const int ret =
+                run_block(&statement->body, arena, false, subshell);
+            if (ret != 0) return ret;
+            status = get_exit_status();
+            if (interrupted()) {
+                set_exit_status(status);
+                return 0;
+            }
+
+            field = next;
+        }
+    }
+
+    set_exit_status(status);
+    return 0;
+}
+
+/**
+ * @brief Run a loop, which SIGINT stops between its commands.
+ */
+static int run_loop(const Statement *const statement, Arena *const arena,
+                    const bool subshell) {
+    struct sigaction old_sa;
+    struct sigaction sa = {
+        .sa_handler = interrupt_line,
+        .sa_flags   = 0,
+    };
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, &old_sa);
+
+    const int ret = statement->type == STATEMENT_WHILE
+                        ? run_while(&statement->loop, arena, subshell)
+                        : run_for(statement, arena, subshell);
+
+    sigaction(SIGINT, &old_sa, NULL);
+
+    if (ret == 0 && interrupted()) set_exit_status(128 + SIGINT);
+    return ret;
+}
+
+/**
+ * @return 0 on continue, STOP_EXIT or STOP_RETURN
+ */
+static int run_statement(const Statement *const statement, Arena *const arena,
+                         const bool batch, const bool subshell) {
+    switch (statement->type) {
+        case STATEMENT_PIPELINE:
+            return run_pipeline(statement->pipeline, arena, batch, subshell);
+        case STATEMENT_IF:
+            return run_if(statement, arena, subshell);
+        case STATEMENT_WHILE:
+        case STATEMENT_FOR:
+            return run_loop(statement, arena, subshell);
+        case STATEMENT_FUNCTION:
+            set_exit_status(define_function(statement->name,
+                                            statement->source)
+                                ? EXIT_SUCCESS
+                                : EXIT_FAILURE);
+            return 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief Run the statements of a block in order.
+ *
+ * @param [in] batch Whether the last statement may run in place of the shell,
+ * see exec_program.
+ * @return 0 on continue, STOP_EXIT or STOP_RETURN
+ */
+static int run_block(const Block *const block, Arena *const arena,
+                     const bool batch, const bool subshell) {
+    for (size_t i = 0; i < block->n_statement; i++) {
+        const bool last = i == block->n_statement - 1;
+        const int ret =
+            run_statement(&block->statements[i], arena, batch && last,
+                          subshell);
+        if (ret != 0) return ret;
+
+        // the rest of the line is skipped after SIGINT
+        if (interrupted()) break;
+    }
+    return 0;
+}
+
+int exec_program(const Block *const program, Arena *const arena,
+                 const bool batch) {
+    line_interrupted = false;
+    take_sigint();
+    return run_block(program, arena, batch, false);
+}
+
+/**
+ * @return Whether a command may change the state of the shell, judged before
+ * its words are expanded: unless its name is a plain word naming an executable
+ * or a builtin which runs on a thread, as in changes_shell.
+ */
+static bool command_changes_shell(const Command *const command) {
+    if (command->n_word == 0) return false;
+
+    const Word *const name = &command->words[0];
+    if (name->n_part != 1 || name->parts[0].type != PART_LITERAL) return true;
+
+    char         literal[NAME_MAX + 1];
+    const size_t len = name->parts[0].len;
+    if (len > NAME_MAX) return true;
+    memcpy(literal, name->parts[0].str, len);
+    literal[len] = '\0';
+
+    char *const argv[] = {literal, NULL};
+    return changes_shell(1, argv);
+}
+
+/**
+ * @return Whether a statement of the block may change the state of the shell:
+ * a single command which may, such as an assignment, cd or exit, a for loop,
+ * which sets its variable, or a function definition.
+ */
+static bool block_changes_shell(const Block *const block) {
+    for (size_t i = 0; i < block->n_statement; i++) {
+        const Statement *const statement = &block->statements[i];
+        switch (statement->type) {
+            case STATEMENT_PIPELINE:
+                // the stages of a pipeline run in other processes or threads
+                if (statement->pipeline->n_command == 1 &&
+                    !statement->pipeline->background &&
+                    command_changes_shell(&statement->pipeline->commands[0])) {
+                    return true;
+                }
+                break;
+            case STATEMENT_IF:
+                for (size_t j = 0; j < statement->n_branch; j++) {
+                    const Clause *const branch = &statement->branches[j];
+                    if (block_changes_shell(&branch->condition) ||
+                        block_changes_shell(&branch->body)) {
+                        return true;
+                    }
+                }
+                if (block_changes_shell(&statement->otherwise)) return true;
+                break;
+            case STATEMENT_WHILE:
+                if (block_changes_shell(&statement->loop.condition) ||
+                    block_changes_shell(&statement->loop.body)) {
+                    return true;
+                }
+                break;
+            case STATEMENT_FOR:
+            case STATEMENT_FUNCTION:
+                return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Run a whole list in a child process of the shell and wait for it, so
+ * that the state its statements share stays in the child. exit ends the child.
+ */
+static void run_block_isolated(const Block *const block, Arena *const arena) {
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == -1) {
+        display_error("ERROR: Fork failed\n");
+        set_exit_status(EXIT_FAILURE);
+        return;
+    }
+
+    if (pid == 0) {
+        run_block(block, arena, false, false);
+        fflush(stdout);
+        _exit(get_exit_status());
+    }
+
+    set_exit_status(wait_isolated(pid));
+}
+
+char *capture_output(const Block *const program, Arena *const arena) {
+    const int capture = memfd_create("mysh-capture", MFD_CLOEXEC);
+    if (capture == -1) {
+        display_error("ERROR: Cannot capture output: %s\n", strerror(errno));
+        return arena_strndup(arena, "", 0);
+    }
+
+    // the list writes into the memory file as its stdout, so it never blocks
+    // on a reader and builtins need no thread
+    const FdMapping mapping = {
+        .fd = STDOUT_FILENO, .source = capture, .owned = true};
+    int saved;
+    fflush(stdout);
+    if (save_redirects(&mapping, 1, &saved)) {
+        if (block_changes_shell(program)) {
+            run_block_isolated(program, arena);
+        } else {
+            run_block(program, arena, false, true);
+        }
+        fflush(stdout);
+        restore_redirects(&mapping, 1, &saved);
+    }
+
+    // read the whole output at once
+    struct stat st;
+    size_t      len = fstat(capture, &st) == 0 ? (size_t)st.st_size : 0;
+    char *const out = arena_alloc(arena, len + 1);
+
+    const ssize_t n_read = pread(capture, out, len, 0);
+    len                  = n_read > 0 ? (size_t)n_read : 0;
+    close(capture);
+
+    while (len > 0 && out[len - 1] == '\n') len--;
+    out[len] = '\0';
+
+    return out;
+}
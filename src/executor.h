@@ -0,0 +1,39 @@
+#ifndef __EXECUTOR_H__
+#define __EXECUTOR_H__
+
+#include <stdbool.h>
+
+#include "parser.h"
+#include "utils/arena.h"
+
+/**
+ * @brief Execute a list of statements by walking its AST.
+ *
+ * Compound statements are interpreted in the shell process, and $? is set to
+ * the exit status of each command. Loops release the memory of an iteration
+ * before the next one, so they run in constant memory.
+ *
+ * @param [in] program The list to execute.
+ * @param [in] arena Arena for memory used during execution.
+ * @param [in] batch Whether the shell runs in batch mode. The last command of
+ * the input then runs in place of the shell process if it is a simple
+ * foreground command and no jobs are running.
+ * @return 0 on continue, -1 on exit
+ */
+int exec_program(const Block *program, Arena *arena, bool batch);
+
+/**
+ * @brief Execute a list for a command substitution and capture its output.
+ *
+ * Builtins run in the shell process without forking. If a statement of the
+ * list could change the state of the shell, such as cd, an assignment, exit, a
+ * for loop or a function definition, the whole list runs in one child process
+ * instead, where later statements see the change.
+ *
+ * @param [in] program The list to execute.
+ * @param [in] arena Arena owning the output.
+ * @return The output without trailing newlines.
+ */
+char *capture_output(const Block *program, Arena *arena);
+
+#endif
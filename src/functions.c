@@ -0,0 +1,142 @@
+#include "functions.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/hash.h"
+
+#define FUNCTION_ARENA_SIZE 1024
+
+static const size_t INIT_TABLE_CAPACITY = 16;  // must be a power of 2
+
+typedef struct {
+    char     *name;  // NULL for an empty slot
+    uint64_t  hash;
+    Function *function;
+} FunctionEntry;
+
+static FunctionEntry *table          = NULL;
+static size_t         table_len      = 0;
+static size_t         table_capacity = 0;
+
+void init_functions() {
+    table          = calloc(INIT_TABLE_CAPACITY, sizeof(FunctionEntry));
+    table_len      = 0;
+    table_capacity = INIT_TABLE_CAPACITY;
+}
+
+static void free_function(Function *const function) {
+    arena_free(&function->arena);
+    free(function);
+}
+
+void free_functions() {
+    for (size_t i = 0; i < table_capacity; i++) {
+        if (table[i].name == NULL) continue;
+        free(table[i].name);
+        free_function(table[i].function);
+    }
+    free(table);
+    table          = NULL;
+    table_len      = 0;
+    table_capacity = 0;
+}
+
+/**
+ * @return The slot holding name, or the empty slot where name should be
+ * inserted.
+ */
+static FunctionEntry *find_slot(FunctionEntry *const entries,
+                                const size_t capacity, const char *const name,
+                                const uint64_t hash) {
+    const size_t mask = capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        FunctionEntry *const entry = &entries[i];
+        if (entry->name == NULL) return entry;
+        if (entry->hash == hash && strcmp(entry->name, name) == 0) {
+            return entry;
+        }
+    }
+}
+
+static void grow_table() {
+    const size_t         new_capacity = table_capacity * 2;
+    FunctionEntry *const new_table =
+        calloc(new_capacity, sizeof(FunctionEntry));
+
+    for (size_t i = 0; i < table_capacity; i++) {
+        if (table[i].name == NULL) continue;
+        *find_slot(new_table, new_capacity, table[i].name, table[i].hash) =
+            table[i];
+    }
+
+    free(table);
+    table          = new_table;
+    table_capacity = new_capacity;
+}
+
+/**
+ * @brief Drop a replaced function, which running calls may still hold.
+ */
+static void retire_function(Function *const function) {
+    if (function->n_call == 0) {
+        free_function(function);
+    } else {
+        function->retired = true;
+    }
+}
+
+bool define_function(const char *const name, const char *const source) {
+    const uint64_t hash  = hash_str(name);
+    FunctionEntry *entry = find_slot(table, table_capacity, name, hash);
+
+    if (entry->name != NULL &&
+        strcmp(entry->function->source, source) == 0) {
+        return true;
+    }
+
+    Function *const function = malloc(sizeof(Function));
+    arena_init(&function->arena, FUNCTION_ARENA_SIZE);
+    function->source =
+        arena_strndup(&function->arena, source, strlen(source));
+    function->body    = parse_program(function->source, &function->arena, NULL);
+    function->n_call  = 0;
+    function->retired = false;
+    if (function->body == NULL) {
+        free_function(function);
+        return false;
+    }
+
+    if (entry->name == NULL) {
+        // keep load factor below 1/2
+        if ((table_len + 1) * 2 > table_capacity) {
+            grow_table();
+            entry = find_slot(table, table_capacity, name, hash);
+        }
+        entry->name = strdup(name);
+        entry->hash = hash;
+        table_len++;
+    } else {
+        retire_function(entry->function);
+    }
+    entry->function = function;
+
+    return true;
+}
+
+Function *find_function(const char *const name) {
+    if (table_len == 0) return NULL;
+
+    const FunctionEntry *const entry =
+        find_slot(table, table_capacity, name, hash_str(name));
+    return entry->name != NULL ? entry->function : NULL;
+}
+
+void hold_function(Function *const function) { function->n_call++; }
+
+void release_function(Function *const function) {
+    assert(function->n_call > 0);
+    if (--function->n_call == 0 && function->retired) free_function(function);
+}
@@ -0,0 +1,53 @@
+#ifndef __FUNCTIONS_H__
+#define __FUNCTIONS_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "parser.h"
+#include "utils/arena.h"
+
+/**
+ * A function with its parsed body. Calls hold the function, so that it can be
+ * redefined while it runs.
+ */
+typedef struct {
+    Arena        arena;   // owns source and body
+    const char  *source;  // the body between the braces of the definition
+    const Block *body;
+    size_t       n_call;   // calls running the body
+    bool         retired;  // redefined, and freed after the last call
+} Function;
+
+void init_functions();
+
+void free_functions();
+
+/**
+ * @brief Define a function, replacing any function of the same name.
+ *
+ * The body is parsed once here, so a call only runs it. Running the same
+ * definition again, e.g. in a loop, keeps the parsed body.
+ *
+ * @param [in] name The name of the function.
+ * @param [in] source The body of the function.
+ * @return Whether the body is valid. An error is displayed otherwise.
+ */
+bool define_function(const char *name, const char *source);
+
+/**
+ * @return The function, or NULL if it is not defined.
+ */
+Function *find_function(const char *name);
+
+/**
+ * @brief Keep the body of a function alive for a call.
+ */
+void hold_function(Function *function);
+
+/**
+ * @brief End a call, freeing the body if the function has been redefined.
+ */
+void release_function(Function *function);
+
+#endif
@@ -3,15 +3,74 @@
 #include "io_helpers.h"
 
 #include <errno.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include "utils/minmax.h"
+
+#define INPUT_BLOCK_SIZE 65536
+
+// Buffered input. Bytes in [input_begin, input_end) are read but not consumed.
+static char  *input_buf      = NULL;
+static size_t input_capacity = 0;
+static size_t input_begin    = 0;
+static size_t input_end      = 0;
+static int    input_fd       = STDIN_FILENO;
+static bool   input_eof      = false;
+
+// Whether PROMPT_CONTINUE precedes each continuation line
+static bool input_prompted = false;
+
+// Fd watched while waiting for input, and its handler
+static int input_event_fd = -1;
+static void (*input_event_handler)();
+
 static void handle_sigint() {}
 
-ssize_t get_input(char *in_ptr) {
+/**
+ * @brief Wait until input is readable, handling events meanwhile.
+ * @return 0 on success, or -1 on error.
+ */
+static int wait_input() {
+    if (input_event_fd == -1) return 0;
+
+    while (true) {
+        struct pollfd fds[2] = {
+            {.fd = input_fd, .events = POLLIN},
+            {.fd = input_event_fd, .events = POLLIN},
+        };
+        if (poll(fds, 2, -1) == -1) return -1;
+
+        if (fds[1].revents & POLLIN) input_event_handler();
+        if (fds[0].revents != 0) return 0;
+    }
+}
+
+/**
+ * @brief Read the next block of input into the buffer.
+ * @return number of bytes read, or -1 on error.
+ */
+static ssize_t fill_input() {
+    // move unconsumed bytes to the front
+    if (input_begin > 0) {
+        memmove(input_buf, input_buf + input_begin, input_end - input_begin);
+        input_end   -= input_begin;
+        input_begin  = 0;
+    }
+
+    // keep room for a whole block and the terminating '\0'
+    if (input_capacity < input_end + INPUT_BLOCK_SIZE + 1) {
+        input_capacity = max(input_capacity * 2, INPUT_BLOCK_SIZE + 1);
+        while (input_capacity < input_end + INPUT_BLOCK_SIZE + 1) {
+            input_capacity *= 2;
+        }
+        input_buf = realloc(input_buf, input_capacity);
+    }
+
     // set signal handler
     struct sigaction old_sa;
     struct sigaction sa = {
@@ -21,8 +80,11 @@ ssize_t get_input(char *in_ptr) {
     sigemptyset(&sa.sa_mask);
     sigaction(SIGINT, &sa, &old_sa);
 
-    // Not a sanitizer issue since in_ptr is allocated as MAX_STR_LEN+1
-    const ssize_t read_len = read(STDIN_FILENO, in_ptr, MAX_STR_LEN + 1);
+    const ssize_t read_len =
+        wait_input() == -1
+            ? -1
+            : read(input_fd, input_buf + input_end,
+                   input_capacity - input_end - 1);
     if (read_len == -1 && errno == EINTR) {
         putchar('\n');
     }
@@ -30,91 +92,97 @@ ssize_t get_input(char *in_ptr) {
     // restore signal handler
     sigaction(SIGINT, &old_sa, NULL);
 
-    // read error
-    if (read_len == -1) {
-        in_ptr[0] = '\0';
-        return -1;
-    }
-
-    if (read_len > MAX_STR_LEN) {  // input too long
-        display_error("ERROR: input line too long\n");
-
-        int junk;
-        do {
-            junk = getchar();
-        } while (junk != EOF && junk != '\n');
-
-        in_ptr[0] = '\0';
-        return -1;
-    }
-
-    in_ptr[read_len] = '\0';
+    if (read_len > 0) input_end += read_len;
+    if (read_len == 0) input_eof = true;
     return read_len;
 }
 
-int parse_background(char *const str) {
-    char str_cpy[MAX_STR_LEN];
-    strcpy(str_cpy, str);
-
-    size_t n_token = 0;
-    char  *tokens[MAX_STR_LEN];
+ssize_t get_input(char **const line) {
+    size_t scanned = 0;  // no '\n' in the first scanned unconsumed bytes
+    while (true) {
+        const size_t pending = input_end - input_begin;
+        char *const  newline =
+            pending > scanned ? memchr(input_buf + input_begin + scanned, '\n',
+                                       pending - scanned)
+                              : NULL;
+
+        if (newline != NULL) {
+            *newline = '\0';
+            *line    = input_buf + input_begin;
+
+            const size_t len = newline + 1 - *line;
+            input_begin      = newline + 1 - input_buf;
+            return len;
+        }
 
-    char *token = strtok(str_cpy, DELIMITERS);
-    while (token != NULL) {
-        tokens[n_token++] = token;
-        token             = strtok(NULL, DELIMITERS);
-    }
+        scanned                = pending;
+        const ssize_t read_len = input_eof ? 0 : fill_input();
 
-    for (size_t i = 0; i < n_token; i++) {
-        // if exists a token '&'
-        if (tokens[i][0] == BACKGROUND_SYMBOL && tokens[i][1] == '\0') {
-            // if '&' is not the last token
-            if (i != n_token - 1) {
-                display_error(
-                    "ERROR: Syntax error near unexpected token after `&'\n");
-                return -1;
-            }
+        // read error: drop the partial line
+        if (read_len == -1) {
+            input_begin = input_end = 0;
+            return -1;
+        }
 
-            // remove '&' from the command
-            str[tokens[i] - str_cpy] = '\0';
+        // EOF: return the last line without '\n'
+        if (read_len == 0) {
+            const size_t len = input_end - input_begin;
+            if (len == 0) return 0;
 
-            return 1;
+            input_buf[input_end] = '\0';
+            *line                = input_buf + input_begin;
+            input_begin          = input_end;
+            return len;
         }
     }
+}
+
+ssize_t get_continued_input(char **const line) {
+    if (input_prompted) {
+        display_message(PROMPT_CONTINUE);
+        fflush(stdout);
+    }
+    return get_input(line);
+}
+
+void set_input_prompted(const bool prompted) { input_prompted = prompted; }
+
+void set_input_fd(const int fd) {
+    input_fd  = fd;
+    input_eof = false;
+}
 
-    return 0;
+void set_input_event(const int fd, void (*const handler)()) {
+    input_event_fd      = fd;
+    input_event_handler = handler;
 }
 
-size_t parse_pipe(char *const str, char **const cmds) {
-    size_t n_cmd = 0;
-    char  *cmd   = str;
-    while (cmd != NULL) {
-        cmds[n_cmd++] = cmd;
+void set_input_string(const char *const str) {
+    const size_t len = strlen(str);
 
-        cmd = strchr(cmd, PIPE_SYMBOL);
-        if (cmd == NULL) break;
-        *cmd++ = '\0';
-    }
-    cmds[n_cmd] = NULL;
-    return n_cmd;
+    free(input_buf);
+    input_buf      = malloc(len + 2);
+    input_capacity = len + 2;
+    input_begin    = 0;
+    input_end      = len;
+    input_eof      = true;  // never read after the string
+    memcpy(input_buf, str, len);
 }
 
-size_t tokenize_input(char *const str, char **const tokens) {
-    size_t n_token = 0;
-    char  *token   = strtok(str, DELIMITERS);
-    while (token != NULL) {
-        tokens[n_token++] = token;
-        token             = strtok(NULL, DELIMITERS);
+bool input_at_eof() {
+    while (input_begin == input_end && !input_eof) {
+        // only read what is already there, which a writer may never send
+        struct pollfd fd = {.fd = input_fd, .events = POLLIN};
+        if (poll(&fd, 1, 0) != 1) return false;
+
+        if (fill_input() == -1) return false;
     }
-    tokens[n_token] = NULL;
-    return n_token;
+    return input_begin == input_end;
 }
 
-size_t count_leading_empty_tokens(char *const *const tokens) {
-    size_t count = 0;
-    for (char *const *token = tokens; *token != NULL; token++) {
-        if ((*token)[0] != '\0') break;  // reach the first non-empty token
-        count++;
-    }
-    return count;
+void free_input() {
+    free(input_buf);
+    input_buf      = NULL;
+    input_capacity = 0;
+    input_begin = input_end = 0;
 }
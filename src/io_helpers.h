@@ -1,19 +1,12 @@
 #ifndef __IO_HELPERS_H__
 #define __IO_HELPERS_H__
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <unistd.h>
 
-#define PROMPT "mysh$ "
-
-#define MAX_STR_LEN 128
-
-// Assumption: all input tokens are whitespace delimited
-#define DELIMITERS        " \t\n"
-#define PIPE_SYMBOL       '|'
-#define BACKGROUND_SYMBOL '&'
-
-#define VARIABLE_EXPANSION_SYMBOL "$"
+#define PROMPT          "mysh$ "
+#define PROMPT_CONTINUE "> "  // while a compound statement is incomplete
 
 // ========== OUTPUT MARCOS ==========
 
@@ -31,57 +24,57 @@
 #define display_error(fmt, ...)   fprintf(stderr, fmt, ##__VA_ARGS__)
 
 /**
- * @note Prereq: in_ptr points to a character buffer of size > MAX_STR_LEN
- * @return number of bytes read
+ * @brief Read the next line from stdin.
+ *
+ * Input is read in large blocks and buffered, so each call returns exactly one
+ * line of any length.
+ *
+ * @param line [out] Receives the line without the trailing '\n'.
+ * @return number of bytes consumed including '\n', 0 on EOF, or -1 on error.
+ *
+ * @warning line points to an internal buffer which is valid until the next
+ * call.
  */
-ssize_t get_input(char *in_ptr);
+ssize_t get_input(char **line);
 
 /**
- * @brief Check whether str is a valid background command, and return the parsed
- * command without background symbol.
- *
- * @param str [in, out] The string to parse.
- * @return 1 if str is a background command,
- *         0 if str is not a background command,
- *         -1 on error.
- *
- * @warning str is modified.
+ * @brief Read the next line of a command spanning several lines, like
+ * get_input, after PROMPT_CONTINUE if continuation lines are prompted for.
  */
-int parse_background(char *str);
+ssize_t get_continued_input(char **line);
 
 /**
- * @brief Parse str into commands separated by pipe.
- *
- * @param str [in, out] The string to parse.
- * @param cmds [out] An array receiving pointers to the commands terminated by
- * NULL.
- * @return the number of commands.
- *
- * @warning str is modified.
- * @warning cmds points to the memory in str, so str should live as long as
- * cmds.
+ * @brief Set whether PROMPT_CONTINUE is printed before each continuation line,
+ * for a user at a terminal.
  */
-size_t parse_pipe(char *str, char **cmds);
+void set_input_prompted(bool prompted);
 
 /**
- * @brief Tokenize str into tokens.
- *
- * @param str [in, out] The string to tokenize.
- * @param tokens_view [out] An array receving pointers to the tokens terminated
- * by NULL.
- * @return the number of tokens.
+ * @brief Read input lines from fd instead of stdin.
+ */
+void set_input_fd(int fd);
+
+/**
+ * @brief Call handler whenever fd becomes readable while waiting for input.
+ */
+void set_input_event(int fd, void (*handler)());
+
+/**
+ * @brief Read input lines from str. No more input is read after str.
+ */
+void set_input_string(const char *str);
+
+/**
+ * @brief Check whether all input has been consumed, without waiting for more.
  *
- * @warning str is modified.
- * @warning tokens points to the memory in str, so str should live as long as
- * tokens.
+ * @return false if more input may come, for example while the writer of a pipe
+ * has not closed it yet.
  */
-size_t tokenize_input(char *str, char **tokens);
+bool input_at_eof();
 
 /**
- * @brief Return the number of leading empty tokens.
- * @param token_count [in] to the number of tokens
- * @return the number of leading empty tokens.
+ * @brief Free the input buffer.
  */
-size_t count_leading_empty_tokens(char *const *tokens);
+void free_input();
 
 #endif
@@ -1,32 +1,85 @@
 #define _DEFAULT_SOURCE
+#define _GNU_SOURCE
 
-#include <assert.h>
-#include <errno.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/wait.h>
 #include <unistd.h>
 
+#include "arith.h"
 #include "background.h"
-#include "builtins.h"
-#include "commands.h"
+#include "command_table.h"
+#include "executor.h"
+#include "functions.h"
 #include "io_helpers.h"
+#include "parse_cache.h"
+#include "parser.h"
+#include "types.h"
+#include "utils/arena.h"
 #include "variables.h"
 
-static pid_t executing_pgid = -1;
+#define LINE_ARENA_SIZE     16384
+#define STATUS_SYNTAX_ERROR 2
 
-void sigint_executing_processes() {
-    if (executing_pgid == -1) return;
+// Whether input comes from a user at a terminal. Otherwise mysh runs in batch
+// mode, which prints no prompt.
+static bool interactive = true;
 
-    if (killpg(executing_pgid, SIGINT) == -1) {
-        display_error("ERROR: Failed to send SIGINT to executing processes\n");
+// Owns all memory of the command line being executed
+static Arena line_arena;
+
+/**
+ * @brief Report jobs finishing while waiting at the prompt.
+ */
+static void report_jobs() {
+    if (check_background_status(false) > 0) {
+        display_message(PROMPT);
+        fflush(stdout);
+    }
+}
+
+/**
+ * @brief Read the lines continuing a compound statement, until the statement
+ * is complete, and parse all lines together.
+ *
+ * @param [in] first The first line, which ends inside the statement.
+ * @return The list, or NULL on syntax error or end of input.
+ */
+static const Block *parse_continued(const char *const first) {
+    size_t len  = strlen(first);
+    char  *text = arena_strndup(&line_arena, first, len);
+
+    while (true) {
+        char         *line;
+        const ssize_t read_len = get_continued_input(&line);
+        if (read_len == -1) continue;
+        if (read_len == 0) {
+            display_error("ERROR: Syntax error: unexpected end of file\n");
+            return NULL;
+        }
+
+        // join the lines, which are parsed again as a whole
+        const size_t line_len = strlen(line);
+        text = arena_realloc(&line_arena, text, len + 1, len + line_len + 2);
+        text[len++] = '\n';
+        memcpy(text + len, line, line_len + 1);
+        len += line_len;
+
+        bool               incomplete;
+        const Block *const program =
+            parse_line(text, &line_arena, &incomplete);
+        if (!incomplete) return program;
     }
 }
 
-void init() {
+/**
+ * @brief Initialize the shell and select the input source.
+ *
+ * Usage: mysh [-c <command> | <script>]
+ */
+RetVal init(const int argc, char *const *const argv) {
     setpgid(0, 0);
 
     // Ignore SIGINT
@@ -41,323 +94,103 @@ void init() {
     setvbuf(stdout, NULL, _IOLBF, 0);
     setvbuf(stderr, NULL, _IOLBF, 0);
 
-    init_variables();
-    init_background();
-}
-
-void cleanup() {
-    free_variables();
-    free_background();
-}
-
-void exec(const size_t argc, char *const *const argv, const bool background) {
-    assert(argv[argc] == NULL);  // argv should be NULL-terminated
-
-    // Check for assignment
-    if (argc == 1) {
-        if (exec_assignment(argv[0])) {
-            return;
+    // Select input
+    if (argc >= 2 && strcmp(argv[1], "-c") == 0) {
+        if (argc < 3) {
+            display_error("ERROR: -c requires a command\n");
+            return RETVAL_FAILURE;
         }
-    }
-
-    // Check for builtins
-    if (argc >= 1) {
-        const Builtin *builtin = check_builtin(argv[0]);
-        if (builtin != NULL) {
-            // execute builtin in new process if both:
-            // 1. it is not a builtin which should run in foreground
-            // 2. we are not already running in background
-            const bool new_proc = !builtin->foreground && !background;
-
-            exec_builtin(builtin->fn, argc, argv, new_proc);
-            return;
+        set_input_string(argv[2]);
+        interactive = false;
+
+    } else if (argc >= 2) {
+        const int fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            display_error("ERROR: Cannot open script: %s\n", argv[1]);
+            return RETVAL_FAILURE;
         }
-    }
-
-    // Check for executable
-    exec_executable(argv, !background);
-}
-
-/**
- * @return 0 on continue, -1 on exit
- */
-int execute_command(char *const cmd, const bool background) {
-    // Tokenize
-    char  *tokens[MAX_STR_LEN];
-    size_t n_token = tokenize_input(cmd, tokens);
+        set_input_fd(fd);
+        interactive = false;
 
-    // Expand variables
-    expand_variables(cmd, tokens, n_token);
-
-    char *const *tokens_view = tokens;
-
-    // Drop leading empty tokens
-    size_t n_drop = count_leading_empty_tokens(tokens_view);
-    assert(n_drop <= n_token);
-    tokens_view += n_drop;
-    n_token     -= n_drop;
+    } else {
+        interactive = isatty(STDIN_FILENO);
+    }
 
-    // Skip empty line
-    if (n_token == 0) return 0;
+    DEBUG_PRINT("DEBUG: Interactive: %d\n", interactive);
 
-    // Exit
-    if (strncmp("exit", tokens[0], 5) == 0) return -1;
+    init_variables();
+    init_background();
+    if (interactive) {
+        set_input_event(get_sigchld_fd(), report_jobs);
+        set_input_prompted(true);
+    }
+    init_command_table();
+    init_parse_cache();
+    init_arith_cache();
+    init_functions();
+    arena_init(&line_arena, LINE_ARENA_SIZE);
 
-    exec(n_token, tokens_view, background);
+    return RETVAL_SUCCESS;
+}
 
-    return 0;
+void cleanup() {
+    free_variables();
+    free_background();
+    free_command_table();
+    free_parse_cache();
+    free_arith_cache();
+    free_functions();
+    arena_free(&line_arena);
+    free_input();
 }
 
-int main() {
+int main(int argc, char **argv) {
     DEBUG_PRINT("DEBUG: Main process pid = %d\n", getpid());
 
-    init();
+    if (FAILED(init(argc, argv))) return EXIT_FAILURE;
 
     while (true) {
-        display_message(PROMPT);
-        fflush(stdout);
+        // release all memory of the previous line
+        arena_reset(&line_arena);
+
+        if (interactive) {
+            display_message(PROMPT);
+            fflush(stdout);
+        }
 
         // ========== Input ==========
 
-        char          input_buf[MAX_STR_LEN + 1];
-        const ssize_t read_len = get_input(input_buf);
+        char         *input_buf;
+        const ssize_t read_len = get_input(&input_buf);
         if (read_len == -1) continue;
 
         // Exit by EOF <C-d>
         if (read_len == 0) break;
 
-        // ========== Background ==========
+        // ========== Background Jobs ==========
 
+        // only waits for processes after SIGCHLD
         check_background_status(false);
 
-        const int bg = parse_background(input_buf);
-        if (bg == -1) continue;  // error
+        // ========== Parse ==========
 
-        DEBUG_PRINT("DEBUG: Background: %d\n", bg);
-
-        char job_cmd[MAX_STR_LEN + 1];
-        if (bg) {
-            strncpy(job_cmd, input_buf, MAX_STR_LEN + 1);
-        } else {
-            job_cmd[0] = '\0';
-        }
-
-        // ========== Parse Pipe ==========
-
-        char  *cmds[MAX_STR_LEN];
-        size_t n_command = parse_pipe(input_buf, cmds);
-
-        // validate parsed pipe
-        if (n_command > 1) {
-            for (size_t i = 0; i < n_command; i++) {
-                char *const cmd = cmds[i];
-
-                // if exists an empty command
-                if (cmd[strspn(cmd, DELIMITERS)] == '\0') {
-                    display_error(
-                        "ERROR: Syntax error near unexpected token `|'\n");
-                    n_command = 0;  // <== invalid command flag set here
-                    break;
-                }
-            }
-            // invalid command
-            if (n_command == 0) continue;
-        }
-
-        // Allowcate new string for each command
-        for (size_t i = 0; i < n_command; i++) {
-            char *cmd = cmds[i];
-            cmds[i]   = malloc(MAX_STR_LEN + 1);
-            strcpy(cmds[i], cmd);
-        }
+        bool         incomplete;
+        const Block *program = parse_line(input_buf, &line_arena, &incomplete);
 
-        DEBUG_PRINT("DEBUG: Command count: %zu\n", n_command);
-        for (size_t i = 0; i < n_command; i++) {
-            DEBUG_PRINT("DEBUG: Command %zu: %s\n", i, cmds[i]);
+        // a compound statement continues on the next lines
+        if (incomplete) program = parse_continued(input_buf);
+        if (program == NULL) {
+            set_exit_status(STATUS_SYNTAX_ERROR);
+            continue;
         }
 
         // ========== Execute ==========
 
-        bool exit = false;
-
-        if (n_command == 1) {
-            // single command
-            if (bg) {
-                // run in background
-                pid_t pid = fork();
-                if (pid == -1) {
-                    display_error("ERROR: Fork failed\n");
-                    continue;
-                }
-
-                if (pid) {
-                    // parent process
-                    DEBUG_PRINT("DEBUG: New process started, pid: %d\n", pid);
-
-                    add_background_job(&pid, 1, job_cmd);
-
-                } else {
-                    // child process
-                    close(STDIN_FILENO);
-                    execute_command(cmds[0], true);
-                    exit = true;
-                }
-
-            } else {
-                // run in foreground
-                if (execute_command(cmds[0], false) == -1) {
-                    exit = true;
-                }
-            }
-
-        } else {
-            // pipe
-            int pipe_fd_in[2]  = {-1, -1};
-            int pipe_fd_out[2] = {-1, -1};
-            pipe_fd_in[0]      = dup(STDIN_FILENO);
-
-            int stored_stdin  = dup(STDIN_FILENO);
-            int stored_stdout = dup(STDOUT_FILENO);
-
-            pid_t *pids = malloc(n_command * sizeof(*pids));
-            pid_t  pid  = 0;
-
-            for (size_t i = 0; i < n_command; i++) {
-                DEBUG_PRINT("DEBUG: Executing command %zu\n", i);
-
-                // only pipe_fd_in[0] should be open
-                assert(fcntl(pipe_fd_in[0], F_GETFD) != -1 || errno != EBADF);
-                assert(fcntl(pipe_fd_in[1], F_GETFD) == -1 && errno == EBADF);
-                assert(fcntl(pipe_fd_out[0], F_GETFD) == -1 && errno == EBADF);
-                assert(fcntl(pipe_fd_out[1], F_GETFD) == -1 && errno == EBADF);
-
-                if (i != n_command - 1) {
-                    // if not last command, create new pipe
-                    if (pipe(pipe_fd_out) == -1) {
-                        display_error("ERROR: Pipe failed\n");
-                        break;
-                    }
-                    DEBUG_PRINT("DEBUG: Pipe created: %d %d\n", pipe_fd_out[0],
-                                pipe_fd_out[1]);
-                } else {
-                    // if last command, restore stdout
-                    pipe_fd_out[1] = stored_stdout;
-                    stored_stdout  = -1;
-                }
-
-                // fork
-                pid = fork();
-                if (pid == -1) {
-                    display_error("ERROR: Fork failed\n");
-                    break;
-                }
-
-                pids[i] = pid;
-
-                // execute command
-                if (pid) {
-                    // parent process
-                    DEBUG_PRINT("DEBUG: New process started, pid: %d\n", pid);
-
-                    close(pipe_fd_in[0]);
-                    close(pipe_fd_out[1]);
-
-                } else {
-                    // execution process
-
-                    // set pgid to pid of the first command
-                    // If this is the first command, pids[0] == 0;
-                    // otherwise, pids[0] == pid of the first command.
-                    setpgid(0, pids[0]);
-
-                    // sub-process does not need to read from the output
-                    // pipe
-                    close(pipe_fd_out[0]);
-
-                    // redirect input
-                    if (bg && i == 0) {
-                        // close stdin on the first command in background
-                        close(STDIN_FILENO);
-                    } else {
-                        dup2(pipe_fd_in[0], STDIN_FILENO);
-                    }
-                    close(pipe_fd_in[0]);
-
-                    // redirect output
-                    dup2(pipe_fd_out[1], STDOUT_FILENO);
-                    close(pipe_fd_out[1]);
-
-                    if (i != n_command - 1) {
-                        // Set stdout to full-buffered for piped commands
-                        setvbuf(stdout, NULL, _IOFBF, 0);
-                    } else {
-                        // Reset stdout to line-buffered for the last command
-                        setvbuf(stdout, NULL, _IOLBF, 0);
-                    }
-
-                    execute_command(cmds[i], true);
-
-                    fflush(stdout);
-
-                    exit = true;
-                }
-
-                pipe_fd_in[0]  = pipe_fd_out[0];
-                pipe_fd_out[0] = -1;
-
-                if (exit) break;
-            }  // for commands
-
-            if (pid) {  // in main process
-                if (bg) {
-                    // use pid of the last command
-                    add_background_job(pids, n_command, job_cmd);
-
-                } else {
-                    // handle SIGINT
-                    executing_pgid = pids[0];
-                    struct sigaction old_sa;
-                    struct sigaction sa = {
-                        .sa_handler = sigint_executing_processes,
-                        .sa_flags   = 0,
-                    };
-                    sigemptyset(&sa.sa_mask);
-                    sigaction(SIGINT, &sa, &old_sa);
-
-                    // wait for all sub-process
-                    while (wait(NULL) > 0);
-
-                    // restore SIGINT handler
-                    executing_pgid = -1;
-                    sigaction(SIGINT, &old_sa, NULL);
-                }
-            }
-
-            free(pids);
-
-            // all pipes should be closed
-            assert(fcntl(pipe_fd_in[0], F_GETFD) == -1 && errno == EBADF);
-            assert(fcntl(pipe_fd_in[1], F_GETFD) == -1 && errno == EBADF);
-            assert(fcntl(pipe_fd_out[0], F_GETFD) == -1 && errno == EBADF);
-            assert(fcntl(pipe_fd_out[1], F_GETFD) == -1 && errno == EBADF);
-
-            // restore stdin
-            dup2(stored_stdin, STDIN_FILENO);
-            close(stored_stdin);
-
-            if (pid) {
-                assert(fcntl(stored_stdin, F_GETFD) == -1 && errno == EBADF);
-                assert(fcntl(stored_stdout, F_GETFD) == -1 && errno == EBADF);
-            }
-
-        }  // if n_command == 1
-
-        for (size_t i = 0; i < n_command; i++) free(cmds[i]);
-
-        if (exit) break;
+        if (exec_program(program, &line_arena, !interactive) == -1) break;
     }
 
     cleanup();
 
-    return 0;
+    // the status of the last command, or the one given to exit
+    return get_exit_status();
 }
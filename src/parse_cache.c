@@ -0,0 +1,193 @@
+#include "parse_cache.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io_helpers.h"
+#include "utils/hash.h"
+
+#define PARSE_CACHE_CAPACITY 64
+#define PARSE_CACHE_BUCKETS  128  // must be a power of 2
+#define MAX_CACHED_LINE_LEN  4096
+#define ENTRY_ARENA_SIZE     1024
+
+typedef struct CacheEntry CacheEntry;
+
+struct CacheEntry {
+    uint64_t        hash;
+    const char  *line;  // copy of the line owned by arena
+    size_t       line_len;
+    const Block *program;
+    Arena        arena;  // owns line and program
+
+    CacheEntry *bucket_next;
+    CacheEntry *lru_prev;  // more recently used
+    CacheEntry *lru_next;  // less recently used
+};
+
+static CacheEntry *buckets[PARSE_CACHE_BUCKETS];
+
+// Most and least recently used entries
+static CacheEntry *lru_head = NULL;
+static CacheEntry *lru_tail = NULL;
+
+// An unlinked entry kept for reuse
+static CacheEntry *spare = NULL;
+
+static size_t n_entry = 0;
+static size_t hits    = 0;
+static size_t misses  = 0;
+
+void init_parse_cache() {
+    memset(buckets, 0, sizeof(buckets));
+    lru_head = lru_tail = NULL;
+    n_entry = hits = misses = 0;
+}
+
+static void free_entry(CacheEntry *const entry) {
+    arena_free(&entry->arena);
+    free(entry);
+}
+
+void free_parse_cache() {
+    CacheEntry *entry = lru_head;
+    while (entry != NULL) {
+        CacheEntry *const next = entry->lru_next;
+        free_entry(entry);
+        entry = next;
+    }
+    if (spare != NULL) free_entry(spare);
+    spare = NULL;
+
+    init_parse_cache();
+}
+
+static CacheEntry **find_entry(const char *const line, const size_t line_len,
+                               const uint64_t hash) {
+    CacheEntry **entry = &buckets[hash & (PARSE_CACHE_BUCKETS - 1)];
+    while (*entry != NULL) {
+        if ((*entry)->hash == hash && (*entry)->line_len == line_len &&
+            memcmp((*entry)->line, line, line_len) == 0) {
+            break;
+        }
+        entry = &(*entry)->bucket_next;
+    }
+    return entry;
+}
+
+static void lru_unlink(CacheEntry *const entry) {
+    if (entry->lru_prev != NULL) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        lru_head = entry->lru_next;
+    }
+    if (entry->lru_next != NULL) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        lru_tail = entry->lru_prev;
+    }
+}
+
+static void lru_push_front(CacheEntry *const entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = lru_head;
+    if (lru_head != NULL) lru_head->lru_prev = entry;
+    lru_head = entry;
+    if (lru_tail == NULL) lru_tail = entry;
+}
+
+/**
+ * @return An unlinked entry with an empty arena, recycling the least recently
+ * used one if the cache is full.
+ */
+static CacheEntry *take_entry() {
+    if (spare != NULL) {
+        CacheEntry *const entry = spare;
+        spare                   = NULL;
+        return entry;
+    }
+
+    if (n_entry < PARSE_CACHE_CAPACITY) {
+        CacheEntry *const entry = malloc(sizeof(CacheEntry));
+        arena_init(&entry->arena, ENTRY_ARENA_SIZE);
+        return entry;
+    }
+
+    CacheEntry *const entry = lru_tail;
+    assert(entry != NULL);
+    DEBUG_PRINT("DEBUG: Parse cache evicts: %s\n", entry->line);
+
+    // remove from its bucket
+    CacheEntry **const slot =
+        find_entry(entry->line, entry->line_len, entry->hash);
+    assert(*slot == entry);
+    *slot = entry->bucket_next;
+
+    lru_unlink(entry);
+    n_entry--;
+
+    arena_reset(&entry->arena);
+    return entry;
+}
+
+const Block *parse_line(const char *const line, Arena *const arena,
+                        bool *const incomplete) {
+    const size_t line_len = strlen(line);
+
+    if (line_len > MAX_CACHED_LINE_LEN) {
+        // the list refers to the line, which is overwritten by reading more
+        // input
+        misses++;
+        return parse_program(arena_strndup(arena, line, line_len), arena,
+                             incomplete);
+    }
+
+    const uint64_t     hash = hash_mem(line, line_len);
+    CacheEntry **const slot = find_entry(line, line_len, hash);
+
+    if (*slot != NULL) {
+        hits++;
+        CacheEntry *const entry = *slot;
+        lru_unlink(entry);
+        lru_push_front(entry);
+        *incomplete = false;
+        return entry->program;
+    }
+
+    misses++;
+
+    CacheEntry *const entry = take_entry();
+    char *const       copy  = arena_strndup(&entry->arena, line, line_len);
+
+    const Block *const program = parse_program(copy, &entry->arena, incomplete);
+    if (program == NULL) {
+        // syntax errors are not cached, so that they are reported every time,
+        // nor is incomplete text
+        arena_reset(&entry->arena);
+        spare = entry;
+        return NULL;
+    }
+
+    *entry = (CacheEntry){.hash        = hash,
+                          .line        = copy,
+                          .line_len    = line_len,
+                          .program     = program,
+                          .arena       = entry->arena,
+                          .bucket_next = NULL};
+
+    // insert the new entry, the bucket may have changed after recycling
+    *find_entry(line, line_len, hash) = entry;
+    lru_push_front(entry);
+    n_entry++;
+
+    return program;
+}
+
+ParseCacheStats get_parse_cache_stats() {
+    return (ParseCacheStats){.hits     = hits,
+                             .misses   = misses,
+                             .n_entry  = n_entry,
+                             .capacity = PARSE_CACHE_CAPACITY};
+}
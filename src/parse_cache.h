@@ -0,0 +1,41 @@
+#ifndef __PARSE_CACHE_H__
+#define __PARSE_CACHE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "parser.h"
+#include "utils/arena.h"
+
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t n_entry;
+    size_t capacity;
+} ParseCacheStats;
+
+void init_parse_cache();
+
+void free_parse_cache();
+
+/**
+ * @brief Parse a line, reusing the list of an identical line parsed before.
+ *
+ * Recently used lists are kept in an LRU cache keyed by the line. Their
+ * variables are left unresolved and expanded at execution time, so a hit
+ * skips lexing and parsing entirely.
+ *
+ * @param [in] line The line to parse, or the lines of a compound statement
+ * joined by '\n'.
+ * @param [in] arena Arena owning the list of a line too long to cache.
+ * @param [out] incomplete Receives whether the line ends inside a compound
+ * statement.
+ * @return The list, or NULL on syntax error or incomplete line.
+ *
+ * @warning The returned list is valid until the next call.
+ */
+const Block *parse_line(const char *line, Arena *arena, bool *incomplete);
+
+ParseCacheStats get_parse_cache_stats();
+
+#endif
@@ -0,0 +1,792 @@
+#include "parser.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "io_helpers.h"
+
+// Assumption: all input tokens are whitespace delimited
+#define DELIMITERS                " \t"
+#define SEPARATOR_SYMBOL          ';'
+#define NEWLINE_SYMBOL            '\n'
+#define PIPE_SYMBOL               '|'
+#define BACKGROUND_SYMBOL         '&'
+#define VARIABLE_EXPANSION_SYMBOL '$'
+#define INPUT_SYMBOL              '<'
+#define OUTPUT_SYMBOL             '>'
+#define SUBSTITUTION_OPEN         '('
+#define SUBSTITUTION_CLOSE        ')'
+#define PARAMETER_OPEN            '{'
+#define PARAMETER_CLOSE           '}'
+#define PARAMETER_LENGTH          '#'
+#define PARAMETER_DEFAULT         ":-"
+
+// ========== Lexer ==========
+
+typedef enum {
+    TOKEN_WORD,
+    TOKEN_SEPARATOR,  // ';' or a newline
+    TOKEN_PIPE,
+    TOKEN_BACKGROUND,
+    TOKEN_REDIRECT,
+    TOKEN_END,
+    TOKEN_ERROR,  // the error is already displayed
+} TokenType;
+
+typedef struct {
+    TokenType    type;
+    const char  *begin;          // position in the line
+    Word         word;           // only for TOKEN_WORD
+    RedirectType redirect_type;  // only for TOKEN_REDIRECT
+    int          redirect_fd;    // only for TOKEN_REDIRECT
+} Token;
+
+typedef struct {
+    const char *pos;    // position after the current token
+    Token       token;  // current token
+    Arena      *arena;
+    size_t      n_heredoc;   // in the current pipeline
+    size_t      depth;       // of nested compound statements
+    bool        incomplete;  // the text ended inside a compound statement
+} Parser;
+
+static bool ends_word(const char ch) {
+    return ch == '\0' || ch == SEPARATOR_SYMBOL || ch == NEWLINE_SYMBOL ||
+           ch == PIPE_SYMBOL || ch == BACKGROUND_SYMBOL ||
+           ch == INPUT_SYMBOL || ch == OUTPUT_SYMBOL ||
+           strchr(DELIMITERS, ch) != NULL;
+}
+
+/**
+ * @brief Lex a redirection operator, with an optional fd number before it.
+ * @return Whether there is a redirection operator at the position.
+ */
+static bool lex_redirect(Parser *const parser) {
+    const char *ch = parser->pos;
+
+    // a single digit directly before the operator is the fd
+    int fd = -1;
+    if (isdigit((unsigned char)ch[0]) &&
+        (ch[1] == INPUT_SYMBOL || ch[1] == OUTPUT_SYMBOL)) {
+        fd = *ch++ - '0';
+    }
+
+    Token *const token = &parser->token;
+    if (*ch == INPUT_SYMBOL) {
+        ch++;
+        token->redirect_type = REDIRECT_INPUT;
+        if (fd == -1) fd = STDIN_FILENO;
+        if (*ch == INPUT_SYMBOL) {
+            ch++;
+            token->redirect_type = REDIRECT_HEREDOC;
+            if (*ch == INPUT_SYMBOL) {
+                ch++;
+                token->redirect_type = REDIRECT_HERESTRING;
+            }
+        }
+    } else if (*ch == OUTPUT_SYMBOL) {
+        ch++;
+        token->redirect_type = REDIRECT_OUTPUT;
+        if (fd == -1) fd = STDOUT_FILENO;
+        if (*ch == OUTPUT_SYMBOL) {
+            ch++;
+            token->redirect_type = REDIRECT_APPEND;
+        }
+    } else {
+        return false;
+    }
+
+    if (*ch == BACKGROUND_SYMBOL &&
+        (token->redirect_type == REDIRECT_INPUT ||
+         token->redirect_type == REDIRECT_OUTPUT)) {
+        ch++;
+        token->redirect_type = REDIRECT_DUP;
+    }
+
+    token->type        = TOKEN_REDIRECT;
+    token->redirect_fd = fd;
+    parser->pos        = ch;
+    return true;
+}
+
+/**
+ * @brief Append an element to an array in the arena, growing it when full.
+ * @return The array, which may have moved.
+ */
+static void *push_back(Arena *const arena, void *array, const void *const elem,
+                       const size_t elem_size, size_t *const len,
+                       size_t *const capacity) {
+    if (*len == *capacity) {
+        const size_t new_capacity = *capacity == 0 ? 4 : *capacity * 2;
+        array     = arena_realloc(arena, array, *capacity * elem_size,
+                                  new_capacity * elem_size);
+        *capacity = new_capacity;
+    }
+    memcpy((char *)array + *len * elem_size, elem, elem_size);
+    (*len)++;
+    return array;
+}
+
+/**
+ * @return Whether ch is past the end of a word. With an explicit end, the word
+ * runs up to it instead, and may contain delimiters.
+ */
+static bool at_word_end(const char *const ch, const char *const end) {
+    return end != NULL ? ch >= end : ends_word(*ch);
+}
+
+/**
+ * @return The close symbol matching the open symbol right before begin,
+ * counting nested pairs, or NULL if there is none.
+ */
+static const char *find_closing(const char *const begin, const char open,
+                                const char close) {
+    size_t depth = 1;
+    for (const char *ch = begin; *ch != '\0'; ch++) {
+        if (*ch == open) depth++;
+        if (*ch == close && --depth == 0) return ch;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Lex the parts of a word.
+ *
+ * @param [in,out] pos The start of the word, receives the position after it.
+ * @param [in] end The end of the word, or NULL to end it at a delimiter.
+ * @return Whether the word is valid. An error is displayed otherwise.
+ */
+static bool lex_parts(Arena *const arena, const char **const pos,
+                      const char *const end, Word *const result) {
+    Word   word     = {.parts = NULL, .n_part = 0};
+    size_t capacity = 0;
+
+    const char *ch = *pos;
+    while (!at_word_end(ch, end)) {
+        WordPart part;
+
+        if (*ch == VARIABLE_EXPANSION_SYMBOL && ch[1] == SUBSTITUTION_OPEN &&
+            ch[2] == SUBSTITUTION_OPEN) {
+            if (!parse_arithmetic(&ch, &part)) return false;
+
+        } else if (*ch == VARIABLE_EXPANSION_SYMBOL &&
+                   ch[1] == SUBSTITUTION_OPEN) {
+            // the output of a list
+            part = (WordPart){.type = PART_COMMAND, .str = ch};
+            part.program = parse_substitution(&ch, arena);
+            if (part.program == NULL) return false;
+            part.len = ch - part.str;
+
+        } else if (*ch == VARIABLE_EXPANSION_SYMBOL &&
+                   ch[1] == PARAMETER_OPEN) {
+            if (!parse_parameter(&ch, arena, &part)) return false;
+
+        } else if (*ch == VARIABLE_EXPANSION_SYMBOL &&
+                   !at_word_end(ch + 1, end) &&
+                   ch[1] != VARIABLE_EXPANSION_SYMBOL) {
+            // variable name runs until the next '$' or the end of word
+            const char *const name = ++ch;
+            while (!at_word_end(ch, end) && *ch != VARIABLE_EXPANSION_SYMBOL) {
+                ch++;
+            }
+            part = (WordPart){
+                .type = PART_VARIABLE, .str = name, .len = ch - name};
+
+        } else {
+            // a '$' which does not start a variable is literal
+            const char *const text = ch++;
+            while (!at_word_end(ch, end) && *ch != VARIABLE_EXPANSION_SYMBOL) {
+                ch++;
+            }
+            part = (WordPart){
+                .type = PART_LITERAL, .str = text, .len = ch - text};
+        }
+
+        // merge adjacent literals
+        WordPart *const last =
+            word.n_part > 0 ? &word.parts[word.n_part - 1] : NULL;
+        if (part.type == PART_LITERAL && last != NULL &&
+            last->type == PART_LITERAL) {
+            last->len += part.len;
+            continue;
+        }
+
+        word.parts = push_back(arena, word.parts, &part, sizeof(WordPart),
+                               &word.n_part, &capacity);
+    }
+
+    *pos    = ch;
+    *result = word;
+    return true;
+}
+
+/**
+ * @return Whether the word is valid. An error is displayed otherwise.
+ */
+static bool lex_word(Parser *const parser, Word *const result) {
+    return lex_parts(parser->arena, &parser->pos, NULL, result);
+}
+
+static void next_token(Parser *const parser) {
+    parser->pos += strspn(parser->pos, DELIMITERS);
+
+    Token *const token = &parser->token;
+    token->begin       = parser->pos;
+
+    switch (*parser->pos) {
+        case '\0':
+            token->type = TOKEN_END;
+            break;
+        case SEPARATOR_SYMBOL:
+        case NEWLINE_SYMBOL:
+            token->type = TOKEN_SEPARATOR;
+            parser->pos++;
+            break;
+        case PIPE_SYMBOL:
+            token->type = TOKEN_PIPE;
+            parser->pos++;
+            break;
+        case BACKGROUND_SYMBOL:
+            token->type = TOKEN_BACKGROUND;
+            parser->pos++;
+            break;
+        default:
+            if (lex_redirect(parser)) break;
+
+            token->type = lex_word(parser, &token->word) ? TOKEN_WORD
+                                                          : TOKEN_ERROR;
+            break;
+    }
+}
+
+static void display_syntax_error(const Parser *const parser) {
+    const Token *const token = &parser->token;
+    if (token->type == TOKEN_END || *token->begin == NEWLINE_SYMBOL) {
+        display_error("ERROR: Syntax error near unexpected token `newline'\n");
+    } else {
+        display_error("ERROR: Syntax error near unexpected token `%.*s'\n",
+                      (int)(parser->pos - token->begin), token->begin);
+    }
+}
+
+// ========== Parser ==========
+
+#define FUNCTION_PARENS "()"
+
+// Reserved words which end a list
+static const char *const LIST_ENDS[] = {"then", "elif", "else", "fi",
+                                        "do",   "done", "}"};
+
+/**
+ * @return Whether the token is the unexpanded word keyword.
+ */
+static bool is_keyword(const Token *const token, const char *const keyword) {
+    if (token->type != TOKEN_WORD || token->word.n_part != 1) return false;
+
+    const WordPart *const part = &token->word.parts[0];
+    return part->type == PART_LITERAL && part->len == strlen(keyword) &&
+           memcmp(part->str, keyword, part->len) == 0;
+}
+
+static bool ends_list(const Token *const token) {
+    for (size_t i = 0; i < sizeof(LIST_ENDS) / sizeof(LIST_ENDS[0]); i++) {
+        if (is_keyword(token, LIST_ENDS[i])) return true;
+    }
+    return false;
+}
+
+static bool is_reserved(const Token *const token) {
+    return ends_list(token) || is_keyword(token, "if") ||
+           is_keyword(token, "while") || is_keyword(token, "for") ||
+           is_keyword(token, "{");
+}
+
+static bool is_name_n(const char *const str, const size_t len) {
+    if (len == 0 || isdigit((unsigned char)str[0])) return false;
+
+    for (size_t i = 0; i < len; i++) {
+        if (!isalnum((unsigned char)str[i]) && str[i] != '_') return false;
+    }
+    return true;
+}
+
+/**
+ * @return Whether the token is a literal variable name.
+ */
+static bool is_name(const Token *const token) {
+    if (token->type != TOKEN_WORD || token->word.n_part != 1) return false;
+
+    const WordPart *const part = &token->word.parts[0];
+    return part->type == PART_LITERAL && is_name_n(part->str, part->len);
+}
+
+/**
+ * @return Whether the command is valid. An empty command is valid.
+ */
+static bool parse_command(Parser *const parser, Command *const command) {
+    *command = (Command){
+        .words = NULL, .n_word = 0, .redirects = NULL, .n_redirect = 0};
+    size_t words_capacity     = 0;
+    size_t redirects_capacity = 0;
+
+    while (true) {
+        const Token *const token = &parser->token;
+
+        // a reserved word is not a command
+        if (command->n_word == 0 && command->n_redirect == 0 &&
+            is_reserved(token)) {
+            return true;
+        }
+
+        if (token->type == TOKEN_WORD) {
+            command->words =
+                push_back(parser->arena, command->words, &token->word,
+                          sizeof(Word), &command->n_word, &words_capacity);
+
+        } else if (token->type == TOKEN_REDIRECT) {
+            Redirect redirect = {.type = token->redirect_type,
+                                 .fd   = token->redirect_fd};
+
+            // the target follows the operator
+            next_token(parser);
+            if (token->type != TOKEN_WORD) {
+                if (token->type != TOKEN_ERROR) display_syntax_error(parser);
+                return false;
+            }
+            redirect.target = token->word;
+
+            if (redirect.type == REDIRECT_HEREDOC && parser->depth > 0) {
+                display_error(
+                    "ERROR: Here-documents are not supported in compound "
+                    "statements\n");
+                return false;
+            }
+
+            if (redirect.type == REDIRECT_HEREDOC) {
+                // the delimiter is not expanded
+                WordPart *const part =
+                    arena_alloc(parser->arena, sizeof(WordPart));
+                *part = (WordPart){.type = PART_LITERAL,
+                                   .str  = token->begin,
+                                   .len  = parser->pos - token->begin};
+                redirect.target  = (Word){.parts = part, .n_part = 1};
+                redirect.heredoc = parser->n_heredoc++;
+            }
+
+            command->redirects = push_back(
+                parser->arena, command->redirects, &redirect,
+                sizeof(Redirect), &command->n_redirect, &redirects_capacity);
+
+        } else {
+            return token->type != TOKEN_ERROR;
+        }
+
+        next_token(parser);
+    }
+}
+
+/**
+ * @return The pipeline starting at the current token, or NULL on syntax error.
+ */
+static Pipeline *parse_pipeline(Parser *const parser) {
+    const char *const text_begin = parser->token.begin;
+    parser->n_heredoc            = 0;
+
+    Pipeline *const pipeline = arena_alloc(parser->arena, sizeof(Pipeline));
+    *pipeline                = (Pipeline){.commands   = NULL,
+                                          .n_command  = 0,
+                                          .background = false,
+                                          .text       = "",
+                                          .n_heredoc  = 0};
+    size_t capacity          = 0;
+
+    while (true) {
+        Command command;
+        if (!parse_command(parser, &command)) return NULL;
+        if (command.n_word == 0 && command.n_redirect == 0) {
+            display_syntax_error(parser);
+            return NULL;
+        }
+
+        pipeline->commands =
+            push_back(parser->arena, pipeline->commands, &command,
+                      sizeof(Command), &pipeline->n_command, &capacity);
+
+        if (parser->token.type != TOKEN_PIPE) break;
+        next_token(parser);
+    }
+
+    const char *const text_end = parser->token.begin;
+
+    if (parser->token.type == TOKEN_BACKGROUND) {
+        pipeline->background = true;
+        next_token(parser);
+    }
+
+    pipeline->text =
+        arena_strndup(parser->arena, text_begin, text_end - text_begin);
+    pipeline->n_heredoc = parser->n_heredoc;
+
+    return pipeline;
+}
+
+static bool parse_list(Parser *parser, Block *block);
+
+/**
+ * @brief Skip the keyword expected at the current token.
+ * @return Whether the keyword is there. Otherwise, the text is incomplete if
+ * it has ended, or an error is displayed.
+ */
+static bool expect_keyword(Parser *const parser, const char *const keyword) {
+    const Token *const token = &parser->token;
+    if (is_keyword(token, keyword)) {
+        next_token(parser);
+        return true;
+    }
+
+    if (token->type == TOKEN_END) {
+        parser->incomplete = true;
+    } else if (token->type != TOKEN_ERROR) {
+        display_syntax_error(parser);
+    }
+    return false;
+}
+
+/**
+ * @brief Parse the list of a compound statement, which must not be empty.
+ */
+static bool parse_body(Parser *const parser, Block *const block) {
+    if (!parse_list(parser, block)) return false;
+
+    // an empty list at the end of the text may still continue
+    if (block->n_statement == 0 && parser->token.type != TOKEN_END) {
+        display_syntax_error(parser);
+        return false;
+    }
+    return true;
+}
+
+static bool parse_if(Parser *const parser, Statement *const statement) {
+    *statement = (Statement){.type = STATEMENT_IF, .branches = NULL};
+    size_t capacity = 0;
+
+    // 'if' or 'elif'
+    do {
+        next_token(parser);
+
+        Clause branch;
+        if (!parse_body(parser, &branch.condition) ||
+            !expect_keyword(parser, "then") ||
+            !parse_body(parser, &branch.body)) {
+            return false;
+        }
+
+        statement->branches =
+            push_back(parser->arena, statement->branches, &branch,
+                      sizeof(Clause), &statement->n_branch, &capacity);
+    } while (is_keyword(&parser->token, "elif"));
+
+    if (is_keyword(&parser->token, "else")) {
+        next_token(parser);
+        if (!parse_body(parser, &statement->otherwise)) return false;
+    }
+
+    return expect_keyword(parser, "fi");
+}
+
+static bool parse_while(Parser *const parser, Statement *const statement) {
+    statement->type = STATEMENT_WHILE;
+
+    next_token(parser);
+    return parse_body(parser, &statement->loop.condition) &&
+           expect_keyword(parser, "do") &&
+           parse_body(parser, &statement->loop.body) &&
+           expect_keyword(parser, "done");
+}
+
+static bool parse_for(Parser *const parser, Statement *const statement) {
+    *statement = (Statement){.type = STATEMENT_FOR, .words = NULL, .n_word = 0};
+    size_t capacity = 0;
+
+    const Token *const token = &parser->token;
+
+    next_token(parser);
+    if (!is_name(token)) {
+        if (token->type == TOKEN_END) {
+            parser->incomplete = true;
+        } else if (token->type != TOKEN_ERROR) {
+            display_syntax_error(parser);
+        }
+        return false;
+    }
+    const WordPart *const name = &token->word.parts[0];
+    statement->variable = arena_strndup(parser->arena, name->str, name->len);
+
+    next_token(parser);
+    while (token->type == TOKEN_SEPARATOR) next_token(parser);
+    if (!expect_keyword(parser, "in")) return false;
+
+    while (token->type == TOKEN_WORD) {
+        statement->words =
+            push_back(parser->arena, statement->words, &token->word,
+                      sizeof(Word), &statement->n_word, &capacity);
+        next_token(parser);
+    }
+
+    // the words end with a separator
+    if (token->type != TOKEN_SEPARATOR) {
+        if (token->type == TOKEN_END) {
+            parser->incomplete = true;
+        } else if (token->type != TOKEN_ERROR) {
+            display_syntax_error(parser);
+        }
+        return false;
+    }
+    while (token->type == TOKEN_SEPARATOR) next_token(parser);
+
+    return expect_keyword(parser, "do") &&
+           parse_body(parser, &statement->body) &&
+           expect_keyword(parser, "done");
+}
+
+/**
+ * @brief Check whether the current token begins a function definition, as
+ * name() or name (). The separate '()' is skipped.
+ *
+ * @param [out] name_len Receives the length of the name.
+ */
+static bool lex_function_name(Parser *const parser, size_t *const name_len) {
+    const Token *const token = &parser->token;
+    if (token->type != TOKEN_WORD || token->word.n_part != 1 ||
+        token->word.parts[0].type != PART_LITERAL) {
+        return false;
+    }
+
+    const WordPart *const part       = &token->word.parts[0];
+    const size_t          parens_len = strlen(FUNCTION_PARENS);
+
+    // name()
+    if (part->len > parens_len &&
+        memcmp(part->str + part->len - parens_len, FUNCTION_PARENS,
+               parens_len) == 0 &&
+        is_name_n(part->str, part->len - parens_len)) {
+        *name_len = part->len - parens_len;
+        return true;
+    }
+
+    // name ()
+    const char *const parens = parser->pos + strspn(parser->pos, DELIMITERS);
+    if (is_name(token) &&
+        strncmp(parens, FUNCTION_PARENS, parens_len) == 0 &&
+        ends_word(parens[parens_len])) {
+        parser->pos = parens + parens_len;
+        *name_len   = part->len;
+        return true;
+    }
+
+    return false;
+}
+
+static bool parse_function(Parser *const parser, Statement *const statement,
+                           const size_t name_len) {
+    const Token *const token = &parser->token;
+
+    *statement = (Statement){.type = STATEMENT_FUNCTION};
+    statement->name =
+        arena_strndup(parser->arena, token->word.parts[0].str, name_len);
+
+    next_token(parser);
+    while (token->type == TOKEN_SEPARATOR) next_token(parser);
+
+    // the body is kept as text, since the definition must outlive the line
+    const char *const body_begin = parser->pos;
+    if (!expect_keyword(parser, "{")) return false;
+
+    Block body;
+    if (!parse_body(parser, &body)) return false;
+    const char *const body_end = token->begin;
+    if (!expect_keyword(parser, "}")) return false;
+
+    statement->source =
+        arena_strndup(parser->arena, body_begin, body_end - body_begin);
+    return true;
+}
+
+static bool parse_statement(Parser *const parser, Statement *const statement) {
+    const Token *const token = &parser->token;
+
+    bool (*parse_compound)(Parser *, Statement *) = NULL;
+    if (is_keyword(token, "if")) {
+        parse_compound = parse_if;
+    } else if (is_keyword(token, "while")) {
+        parse_compound = parse_while;
+    } else if (is_keyword(token, "for")) {
+        parse_compound = parse_for;
+    }
+
+    if (parse_compound != NULL) {
+        parser->depth++;
+        const bool valid = parse_compound(parser, statement);
+        parser->depth--;
+        return valid;
+    }
+
+    size_t name_len;
+    if (lex_function_name(parser, &name_len)) {
+        parser->depth++;
+        const bool valid = parse_function(parser, statement, name_len);
+        parser->depth--;
+        return valid;
+    }
+
+    const Pipeline *const pipeline = parse_pipeline(parser);
+    *statement = (Statement){.type = STATEMENT_PIPELINE, .pipeline = pipeline};
+    return pipeline != NULL;
+}
+
+/**
+ * @brief Parse statements up to the end of the text or a reserved word which
+ * ends a list.
+ * @return Whether the list is valid. An empty list is valid.
+ */
+static bool parse_list(Parser *const parser, Block *const block) {
+    *block          = (Block){.statements = NULL, .n_statement = 0};
+    size_t capacity = 0;
+
+    const Token *const token = &parser->token;
+    while (true) {
+        while (token->type == TOKEN_SEPARATOR) next_token(parser);
+        if (token->type == TOKEN_END || ends_list(token)) return true;
+
+        Statement statement;
+        if (!parse_statement(parser, &statement)) return false;
+
+        block->statements =
+            push_back(parser->arena, block->statements, &statement,
+                      sizeof(Statement), &block->n_statement, &capacity);
+
+        // a background pipeline is already terminated by its '&'
+        if (statement.type == STATEMENT_PIPELINE &&
+            statement.pipeline->background) {
+            continue;
+        }
+
+        if (token->type != TOKEN_SEPARATOR && token->type != TOKEN_END &&
+            !ends_list(token)) {
+            if (token->type != TOKEN_ERROR) display_syntax_error(parser);
+            return false;
+        }
+    }
+}
+
+Block *parse_program(const char *const text, Arena *const arena,
+                     bool *const incomplete) {
+    Parser parser = {.pos        = text,
+                     .arena      = arena,
+                     .n_heredoc  = 0,
+                     .depth      = 0,
+                     .incomplete = false};
+    if (incomplete != NULL) *incomplete = false;
+
+    Block *const program = arena_alloc(arena, sizeof(Block));
+
+    next_token(&parser);
+    if (!parse_list(&parser, program)) {
+        if (parser.incomplete && incomplete != NULL) {
+            *incomplete = true;
+        } else if (parser.incomplete) {
+            display_syntax_error(&parser);
+        }
+        return NULL;
+    }
+
+    // a reserved word ending a list which was never begun
+    if (parser.token.type != TOKEN_END) {
+        display_syntax_error(&parser);
+        return NULL;
+    }
+
+    return program;
+}
+
+bool parse_arithmetic(const char **const pos, WordPart *const part) {
+    const char *const begin = *pos + 3;  // after '$(('
+
+    // the inner parentheses must close right before the outer ones
+    const char *const close =
+        find_closing(begin, SUBSTITUTION_OPEN, SUBSTITUTION_CLOSE);
+    if (close == NULL || close[1] != SUBSTITUTION_CLOSE) {
+        display_error("ERROR: Syntax error: unmatched `$(('\n");
+        return false;
+    }
+
+    *part = (WordPart){.type = PART_ARITH, .str = begin, .len = close - begin};
+    *pos  = close + 2;
+    return true;
+}
+
+Block *parse_substitution(const char **const pos, Arena *const arena) {
+    const char *const begin = *pos + 2;  // after '$('
+
+    const char *const ch =
+        find_closing(begin, SUBSTITUTION_OPEN, SUBSTITUTION_CLOSE);
+    if (ch == NULL) {
+        display_error("ERROR: Syntax error: unmatched `$('\n");
+        return NULL;
+    }
+
+    // the list refers to its own copy of the text
+    const char *const text    = arena_strndup(arena, begin, ch - begin);
+    Block *const      program = parse_program(text, arena, NULL);
+
+    *pos = ch + 1;
+    return program;
+}
+
+bool parse_parameter(const char **const pos, Arena *const arena,
+                     WordPart *const part) {
+    const char *const begin = *pos + 2;  // after '${'
+    const char *const close =
+        find_closing(begin, PARAMETER_OPEN, PARAMETER_CLOSE);
+    if (close == NULL) {
+        display_error("ERROR: Syntax error: unmatched `${'\n");
+        return false;
+    }
+
+    *part = (WordPart){.type = PART_VARIABLE, .str = begin};
+    if (*part->str == PARAMETER_LENGTH) {
+        part->type = PART_LENGTH;
+        part->str++;
+    }
+
+    const char *name_end = part->str;
+    while (name_end < close && *name_end != PARAMETER_DEFAULT[0]) name_end++;
+    part->len = name_end - part->str;
+
+    if (name_end < close) {
+        // ${name:-fallback}, where fallback is a word up to the '}'
+        const size_t op_len = strlen(PARAMETER_DEFAULT);
+        if (part->type == PART_VARIABLE &&
+            strncmp(name_end, PARAMETER_DEFAULT, op_len) == 0) {
+            const char *fallback_pos = name_end + op_len;
+            Word *const fallback     = arena_alloc(arena, sizeof(Word));
+            if (!lex_parts(arena, &fallback_pos, close, fallback)) {
+                return false;
+            }
+            part->type     = PART_DEFAULT;
+            part->fallback = fallback;
+        } else {
+            part->len = 0;  // unsupported operator
+        }
+    }
+
+    if (part->len == 0) {
+        display_error("ERROR: Bad substitution: %.*s\n",
+                      (int)(close + 1 - *pos), *pos);
+        return false;
+    }
+
+    *pos = close + 1;
+    return true;
+}
@@ -0,0 +1,204 @@
+#ifndef __PARSER_H__
+#define __PARSER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "utils/arena.h"
+
+// ========== AST ==========
+
+typedef struct Pipeline  Pipeline;
+typedef struct Word      Word;
+typedef struct Statement Statement;
+
+typedef enum {
+    PART_LITERAL,   // text used as is
+    PART_VARIABLE,  // $name or ${name}
+    PART_DEFAULT,   // ${name:-fallback}
+    PART_LENGTH,    // ${#name}
+    PART_COMMAND,   // $(list), replaced by its output
+    PART_ARITH,     // $((expression)), str is the expression
+} WordPartType;
+
+/**
+ * A list of statements, executed in order.
+ */
+typedef struct {
+    Statement *statements;
+    size_t     n_statement;  // 0 for an empty line
+} Block;
+
+typedef struct {
+    WordPartType type;
+    const char  *str;  // literal text or variable name, not NUL-terminated
+    size_t       len;
+    union {
+        const Word  *fallback;  // only for PART_DEFAULT
+        const Block *program;   // only for PART_COMMAND
+    };
+} WordPart;
+
+/**
+ * A word is expanded by concatenating its parts.
+ */
+struct Word {
+    WordPart *parts;
+    size_t    n_part;
+};
+
+typedef enum {
+    REDIRECT_INPUT,       // fd < target
+    REDIRECT_OUTPUT,      // fd > target
+    REDIRECT_APPEND,      // fd >> target
+    REDIRECT_DUP,         // fd >& target or fd <& target, target is a fd
+    REDIRECT_HEREDOC,     // fd << target, target is the delimiter line
+    REDIRECT_HERESTRING,  // fd <<< target
+} RedirectType;
+
+typedef struct {
+    RedirectType type;
+    int          fd;  // fd to redirect
+    Word         target;
+    size_t       heredoc;  // index among the heredocs of the pipeline, only
+                           // for REDIRECT_HEREDOC
+} Redirect;
+
+typedef struct {
+    Word     *words;
+    size_t    n_word;
+    Redirect *redirects;  // in the order they are applied
+    size_t    n_redirect;
+} Command;
+
+struct Pipeline {
+    Command    *commands;
+    size_t      n_command;  // 0 for an empty line
+    bool        background;
+    const char *text;       // source text without '&'
+    size_t      n_heredoc;  // bodies are read from the lines after it
+};
+
+typedef enum {
+    STATEMENT_PIPELINE,
+    STATEMENT_IF,
+    STATEMENT_WHILE,
+    STATEMENT_FOR,
+    STATEMENT_FUNCTION,  // a definition
+} StatementType;
+
+/**
+ * A body executed if its condition succeeds, i.e. the exit status of the last
+ * statement of the condition is 0.
+ */
+typedef struct {
+    Block condition;
+    Block body;
+} Clause;
+
+struct Statement {
+    StatementType type;
+    union {
+        const Pipeline *pipeline;  // only for STATEMENT_PIPELINE
+
+        struct {                // only for STATEMENT_IF
+            Clause *branches;   // the if and elif clauses
+            size_t  n_branch;
+            Block   otherwise;  // else, or empty
+        };
+
+        Clause loop;  // only for STATEMENT_WHILE
+
+        struct {                   // only for STATEMENT_FOR
+            const char *variable;  // NUL-terminated
+            Word       *words;     // split into fields after expansion
+            size_t      n_word;
+            Block       body;
+        };
+
+        struct {                 // only for STATEMENT_FUNCTION
+            const char *name;    // NUL-terminated
+            const char *source;  // the body between the braces, parsed again
+                                 // when the function is defined
+        };
+    };
+};
+
+// ========== Parser ==========
+
+/**
+ * @brief Parse a list of statements in a single pass.
+ *
+ * Grammar:
+ *   list      := { separator } [ statement { terminator statement }
+ *                { separator } ]
+ *   statement := pipeline | if | while | for | function
+ *   if        := 'if' list 'then' list { 'elif' list 'then' list }
+ *                [ 'else' list ] 'fi'
+ *   while     := 'while' list 'do' list 'done'
+ *   for       := 'for' name { separator } 'in' { word } separator
+ *                { separator } 'do' list 'done'
+ *   function  := name '()' { separator } '{' list '}'
+ *   pipeline  := command { '|' command } [ '&' ]
+ *   command   := ( word | redirect ) { word | redirect }
+ *   redirect  := [ digit ] ( '<' | '>' | '>>' | '<&' | '>&' | '<<' | '<<<' )
+ *                word
+ *   separator := ';' | newline
+ *
+ * A statement is terminated by a separator, or by '&' for a pipeline. The
+ * lists of compound statements are not empty. Reserved words are only
+ * recognized as the first word of a command.
+ *
+ * The delimiter of a heredoc ('<<') is taken literally. Heredocs are not
+ * supported in compound statements, whose bodies are read before they run. A
+ * word may contain parameters '${' [ '#' ] name [ ':-' word ] '}', command
+ * substitutions '$(' list ')' and arithmetic expansions '$((' expression
+ * '))'. Command substitutions are parsed along with the word, and arithmetic
+ * expressions are compiled when first evaluated.
+ *
+ * @param [in] text The text to parse, which may span several lines.
+ * @param [in] arena Arena owning the returned list.
+ * @param [out] incomplete Receives whether the text ends inside a compound
+ * statement, so that it continues on the next line. If NULL, this is a syntax
+ * error instead.
+ * @return The list, or NULL on syntax error or incomplete text.
+ *
+ * @warning The parts of the words point to the memory in text, so text should
+ * live as long as the list.
+ */
+Block *parse_program(const char *text, Arena *arena, bool *incomplete);
+
+/**
+ * @brief Parse a braced parameter: ${name}, ${name:-fallback} or ${#name}.
+ *
+ * @param [in,out] pos Points to the '${' to parse, and receives the position
+ * after the matching '}'.
+ * @param [in] arena Arena owning the fallback word.
+ * @param [out] part Receives the parameter.
+ * @return Whether the parameter is valid. Otherwise, an error is displayed and
+ * pos is unchanged.
+ */
+bool parse_parameter(const char **pos, Arena *arena, WordPart *part);
+
+/**
+ * @brief Parse an arithmetic expansion.
+ *
+ * @param [in,out] pos Points to the '$((' to parse, and receives the position
+ * after the matching '))'.
+ * @param [out] part Receives the expansion.
+ * @return Whether the expansion is terminated. Otherwise, an error is
+ * displayed and pos is unchanged.
+ */
+bool parse_arithmetic(const char **pos, WordPart *part);
+
+/**
+ * @brief Parse a command substitution.
+ *
+ * @param [in,out] pos Points to the '$(' to parse, and receives the position
+ * after the matching ')'.
+ * @param [in] arena Arena owning the returned list.
+ * @return The list inside the parentheses, or NULL on syntax error.
+ */
+Block *parse_substitution(const char **pos, Arena *arena);
+
+#endif
@@ -0,0 +1,271 @@
+#define _GNU_SOURCE
+
+#include "redirect.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "io_helpers.h"
+#include "utils/copy.h"
+#include "variables.h"
+
+#define SAVED_FD_MIN 10  // fds of the shell are kept out of the way of user fds
+
+static int open_flags(const RedirectType type) {
+    switch (type) {
+        case REDIRECT_INPUT:
+            return O_RDONLY | O_CLOEXEC;
+        case REDIRECT_OUTPUT:
+            return O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        case REDIRECT_APPEND:
+            return O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * @brief Move a fd out of the range of fds which are usually redirected, so
+ * that applying an earlier redirection cannot replace it.
+ */
+static int move_fd_high(const int fd) {
+    if (fd == -1 || fd >= SAVED_FD_MIN) return fd;
+
+    const int moved = fcntl(fd, F_DUPFD_CLOEXEC, SAVED_FD_MIN);
+    close(fd);
+    return moved;
+}
+
+/**
+ * @brief Open a file for a redirection.
+ */
+static int open_target(const char *const path, const RedirectType type) {
+    return move_fd_high(open(path, open_flags(type), 0666));
+}
+
+/**
+ * @brief Store data in a sealed memory file to be read from the start.
+ *
+ * Unlike a pipe, the file holds data of any size without a process writing
+ * it, and the seals guarantee that readers see exactly the data.
+ */
+static int open_memfd(const char *const data, const size_t len) {
+    const int fd =
+        memfd_create("mysh-heredoc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1) return -1;
+
+    const int seals = F_SEAL_SEAL | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE;
+    if (!write_all(fd, data, len) || lseek(fd, 0, SEEK_SET) == -1 ||
+        fcntl(fd, F_ADD_SEALS, seals) == -1) {
+        close(fd);
+        return -1;
+    }
+    return move_fd_high(fd);
+}
+
+/**
+ * @return The fd number in str, or -1 if it is not one.
+ */
+static int parse_fd(const char *const str) {
+    if (str[0] == '\0' || strspn(str, "0123456789") != strlen(str)) return -1;
+
+    errno         = 0;
+    const long fd = strtol(str, NULL, 10);
+    if (errno != 0 || fd > INT_MAX) return -1;
+    return fd;
+}
+
+/**
+ * @brief Read the lines of a heredoc body from the input, up to the delimiter
+ * line.
+ *
+ * @param [out] body Receives the lines, each ending with '\n'.
+ * @return Whether the delimiter was found before the end of input.
+ */
+static bool read_heredoc(const WordPart *const delimiter, Arena *const arena,
+                         char **const body) {
+    char  *out      = arena_strndup(arena, "", 0);
+    size_t len      = 0;
+    size_t capacity = 1;
+
+    char   *line;
+    ssize_t read_len;
+    while ((read_len = get_continued_input(&line)) != 0) {
+        if (read_len == -1) continue;
+
+        const size_t line_len = strlen(line);
+        if (line_len == delimiter->len &&
+            memcmp(line, delimiter->str, line_len) == 0) {
+            *body = out;
+            return true;
+        }
+
+        if (len + line_len + 2 > capacity) {
+            const size_t new_capacity = (len + line_len + 2) * 2;
+            out      = arena_realloc(arena, out, capacity, new_capacity);
+            capacity = new_capacity;
+        }
+        memcpy(out + len, line, line_len);
+        len        += line_len;
+        out[len++]  = '\n';
+        out[len]    = '\0';
+    }
+
+    *body = out;
+    return false;
+}
+
+char **read_heredocs(const Pipeline *const pipeline, Arena *const arena) {
+    if (pipeline->n_heredoc == 0) return NULL;
+
+    char **const bodies =
+        arena_alloc(arena, pipeline->n_heredoc * sizeof(char *));
+
+    // in the order of the operators in the line
+    for (size_t i = 0; i < pipeline->n_command; i++) {
+        const Command *const command = &pipeline->commands[i];
+        for (size_t j = 0; j < command->n_redirect; j++) {
+            const Redirect *const redirect = &command->redirects[j];
+            if (redirect->type != REDIRECT_HEREDOC) continue;
+
+            // the delimiter is a single literal part
+            const WordPart *const delimiter = &redirect->target.parts[0];
+            if (!read_heredoc(delimiter, arena, &bodies[redirect->heredoc])) {
+                display_error(
+                    "ERROR: Here-document ended by end of input, wanted "
+                    "`%.*s'\n",
+                    (int)delimiter->len, delimiter->str);
+            }
+        }
+    }
+    return bodies;
+}
+
+/**
+ * @return The fd the redirection reads from or writes to, or -1 with an error
+ * displayed.
+ */
+static int open_source(const Redirect *const redirect,
+                       char *const *const heredocs, Arena *const arena) {
+    if (redirect->type == REDIRECT_HEREDOC) {
+        const char *const body =
+            expand_variables(heredocs[redirect->heredoc], arena);
+        if (body == NULL) return -1;
+
+        const int fd = open_memfd(body, strlen(body));
+        if (fd == -1) {
+            display_error("ERROR: Cannot create here-document: %s\n",
+                          strerror(errno));
+        }
+        return fd;
+    }
+
+    const char *const target = expand_word(&redirect->target, arena);
+    if (target == NULL) return -1;
+
+    if (redirect->type == REDIRECT_HERESTRING) {
+        // the word becomes a line
+        const size_t len  = strlen(target);
+        char *const  text = arena_strndup(arena, target, len + 1);
+        text[len]         = '\n';
+
+        const int fd = open_memfd(text, len + 1);
+        if (fd == -1) {
+            display_error("ERROR: Cannot create here-string: %s\n",
+                          strerror(errno));
+        }
+        return fd;
+    }
+
+    if (redirect->type == REDIRECT_DUP) {
+        const int fd = parse_fd(target);
+        if (fd == -1) display_error("ERROR: Invalid fd: %s\n", target);
+        return fd;
+    }
+
+    const int fd = open_target(target, redirect->type);
+    if (fd == -1) {
+        display_error("ERROR: Cannot open %s: %s\n", target, strerror(errno));
+    }
+    return fd;
+}
+
+ssize_t open_redirects(const Command *const command,
+                       char *const *const heredocs, Arena *const arena,
+                       FdMapping **const mappings) {
+    FdMapping *const result =
+        arena_alloc(arena, command->n_redirect * sizeof(FdMapping));
+
+    for (size_t i = 0; i < command->n_redirect; i++) {
+        const Redirect *const redirect = &command->redirects[i];
+
+        const int source = open_source(redirect, heredocs, arena);
+        if (source == -1) {
+            close_redirects(result, i);
+            return -1;
+        }
+
+        result[i] = (FdMapping){.fd     = redirect->fd,
+                                .source = source,
+                                .owned  = redirect->type != REDIRECT_DUP};
+    }
+
+    *mappings = result;
+    return command->n_redirect;
+}
+
+void close_redirects(const FdMapping *const mappings, const size_t n_mapping) {
+    for (size_t i = 0; i < n_mapping; i++) {
+        if (mappings[i].owned) close(mappings[i].source);
+    }
+}
+
+bool apply_redirects(const FdMapping *const mappings, const size_t n_mapping) {
+    for (size_t i = 0; i < n_mapping; i++) {
+        if (mappings[i].source == mappings[i].fd) {
+            // keep the fd open across exec
+            if (fcntl(mappings[i].fd, F_SETFD, 0) == -1) {
+                display_error("ERROR: Bad fd: %d\n", mappings[i].fd);
+                return false;
+            }
+        } else if (dup2(mappings[i].source, mappings[i].fd) == -1) {
+            display_error("ERROR: Bad fd: %d\n", mappings[i].source);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool save_redirects(const FdMapping *const mappings, const size_t n_mapping,
+                    int *const saved) {
+    for (size_t i = 0; i < n_mapping; i++) {
+        // -1 if the fd was not open, and is closed on restore
+        saved[i] = fcntl(mappings[i].fd, F_DUPFD_CLOEXEC, SAVED_FD_MIN);
+
+        if (dup2(mappings[i].source, mappings[i].fd) == -1) {
+            display_error("ERROR: Bad fd: %d\n", mappings[i].source);
+            restore_redirects(mappings, i + 1, saved);
+            return false;
+        }
+    }
+    return true;
+}
+
+void restore_redirects(const FdMapping *const mappings, const size_t n_mapping,
+                       const int *const saved) {
+    // in reverse, so that an fd redirected twice gets its first value back
+    for (size_t i = n_mapping; i > 0; i--) {
+        const FdMapping *const mapping = &mappings[i - 1];
+        if (saved[i - 1] == -1) {
+            close(mapping->fd);
+        } else {
+            dup2(saved[i - 1], mapping->fd);
+            close(saved[i - 1]);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef __REDIRECT_H__
+#define __REDIRECT_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "parser.h"
+#include "utils/arena.h"
+
+/**
+ * A redirection resolved to fds: fd becomes a copy of source.
+ */
+typedef struct {
+    int  fd;
+    int  source;
+    bool owned;  // whether source was opened for the redirection
+} FdMapping;
+
+/**
+ * @brief Read the bodies of the heredocs of a pipeline from the lines of input
+ * following it.
+ *
+ * @param [in] pipeline The pipeline being executed.
+ * @param [in] arena Arena owning the bodies.
+ * @return The unexpanded bodies indexed by Redirect.heredoc, or NULL if the
+ * pipeline has no heredoc.
+ */
+char **read_heredocs(const Pipeline *pipeline, Arena *arena);
+
+/**
+ * @brief Expand the targets of the redirections of a command and open the
+ * files, close-on-exec. Heredocs and here-strings are stored in sealed memory
+ * files.
+ *
+ * @param [in] command The command to resolve.
+ * @param [in] heredocs The bodies returned by read_heredocs.
+ * @param [in] arena Arena owning the mappings.
+ * @param [out] mappings Receives the mappings in the order to apply them.
+ * @return The number of mappings, or -1 if a file cannot be opened, in which
+ * case an error is displayed and nothing is left open.
+ */
+ssize_t open_redirects(const Command *command, char *const *heredocs,
+                       Arena *arena, FdMapping **mappings);
+
+/**
+ * @brief Close the files opened by open_redirects.
+ */
+void close_redirects(const FdMapping *mappings, size_t n_mapping);
+
+/**
+ * @brief Apply the mappings to the fds of the current process.
+ * @return true on success, or false with an error displayed.
+ */
+bool apply_redirects(const FdMapping *mappings, size_t n_mapping);
+
+/**
+ * @brief Apply the mappings to the fds of the shell, saving the replaced fds
+ * to be restored by restore_redirects.
+ *
+ * @param [out] saved Receives the replaced fds, one per mapping.
+ */
+bool save_redirects(const FdMapping *mappings, size_t n_mapping, int *saved);
+
+/**
+ * @brief Restore the fds replaced by save_redirects.
+ */
+void restore_redirects(const FdMapping *mappings, size_t n_mapping,
+                       const int *saved);
+
+#endif
@@ -0,0 +1,68 @@
+#define _GNU_SOURCE
+
+#include "spawn.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+
+#include "variables.h"
+
+static void redirect(posix_spawn_file_actions_t *const actions, const int fd,
+                     const int target) {
+    if (fd == SPAWN_FD_CLOSE) {
+        posix_spawn_file_actions_addclose(actions, target);
+    } else if (fd >= 0 && fd != target) {
+        posix_spawn_file_actions_adddup2(actions, fd, target);
+    }
+}
+
+pid_t spawn_executable(const char *const path, char *const *const argv,
+                       const SpawnAttr *const attr) {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    redirect(&actions, attr->stdin_fd, STDIN_FILENO);
+    redirect(&actions, attr->stdout_fd, STDOUT_FILENO);
+    for (size_t i = 0; i < attr->n_mapping; i++) {
+        // dup2 to the same fd clears close-on-exec
+        posix_spawn_file_actions_adddup2(&actions, attr->mappings[i].source,
+                                         attr->mappings[i].fd);
+    }
+
+    posix_spawnattr_t spawnattr;
+    posix_spawnattr_init(&spawnattr);
+
+    short flags =
+        POSIX_SPAWN_USEVFORK | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+
+    // the shell ignores SIGINT, which would otherwise be inherited
+    sigset_t sigdefault;
+    sigemptyset(&sigdefault);
+    sigaddset(&sigdefault, SIGINT);
+    posix_spawnattr_setsigdefault(&spawnattr, &sigdefault);
+
+    sigset_t sigmask;
+    sigemptyset(&sigmask);
+    posix_spawnattr_setsigmask(&spawnattr, &sigmask);
+
+    if (attr->pgid != SPAWN_PGID_INHERIT) {
+        flags |= POSIX_SPAWN_SETPGROUP;
+        posix_spawnattr_setpgroup(&spawnattr, attr->pgid);
+    }
+
+    posix_spawnattr_setflags(&spawnattr, flags);
+
+    pid_t     pid;
+    const int err =
+        posix_spawn(&pid, path, &actions, &spawnattr, argv, get_envp());
+
+    posix_spawnattr_destroy(&spawnattr);
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    return pid;
+}
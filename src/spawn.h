@@ -0,0 +1,40 @@
+#ifndef __SPAWN_H__
+#define __SPAWN_H__
+
+#include <sys/types.h>
+
+#include "redirect.h"
+
+#define SPAWN_FD_INHERIT   -1  // keep the fd of the shell
+#define SPAWN_FD_CLOSE     -2  // close the fd in the new process
+#define SPAWN_PGID_INHERIT -1  // stay in the process group of the shell
+#define SPAWN_PGID_NEW     0   // start a new process group
+
+typedef struct {
+    int              stdin_fd;   // fd to become stdin, or SPAWN_FD_*
+    int              stdout_fd;  // fd to become stdout, or SPAWN_FD_*
+    pid_t            pgid;       // process group to join, or SPAWN_PGID_*
+    const FdMapping *mappings;   // redirections applied after stdin and stdout
+    size_t           n_mapping;
+} SpawnAttr;
+
+/**
+ * @brief Start the executable at path in a new process without forking the
+ * shell.
+ *
+ * The new process shares the address space of the shell until it calls exec,
+ * so the cost does not depend on the size of the shell. Signals ignored by the
+ * shell are reset to default and the signal mask is cleared.
+ *
+ * @param [in] path Path of the executable.
+ * @param [in] argv Arguments terminated by NULL.
+ * @param [in] attr How to set up the new process.
+ * @return The pid of the new process, or -1 on error with errno set.
+ *
+ * @note fds other than stdin, stdout and the redirected ones are inherited
+ * unless they are close-on-exec.
+ */
+pid_t spawn_executable(const char *path, char *const *argv,
+                       const SpawnAttr *attr);
+
+#endif
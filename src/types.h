@@ -12,8 +12,12 @@ typedef int RetVal;
 
 #define RETVAL_SUCCESS 0
 #define RETVAL_FAILURE -1
+#define RETVAL_FALSE   1  // succeeded with a false result, e.g. `false`
 
 #define SUCCEEDED(retval) ((retval) >= 0)
 #define FAILED(retval)    ((retval) < 0)
 
+// the exit status of a builtin, as in $?
+#define RETVAL_STATUS(retval) ((retval) == RETVAL_SUCCESS ? 0 : 1)
+
 #endif
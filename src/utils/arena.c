@@ -0,0 +1,125 @@
+#include "arena.h"
+
+#include <assert.h>
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "minmax.h"
+
+struct ArenaBlock {
+    ArenaBlock *next;
+    size_t      size;
+    size_t      used;
+    alignas(max_align_t) unsigned char data[];
+};
+
+static ArenaBlock *new_block(const size_t size) {
+    ArenaBlock *const block = malloc(sizeof(ArenaBlock) + size);
+    block->next             = NULL;
+    block->size             = size;
+    block->used             = 0;
+    return block;
+}
+
+void arena_init(Arena *const arena, const size_t block_size) {
+    arena->first      = new_block(block_size);
+    arena->curr       = arena->first;
+    arena->block_size = block_size;
+}
+
+void arena_free(Arena *const arena) {
+    ArenaBlock *block = arena->first;
+    while (block != NULL) {
+        ArenaBlock *const next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->first = NULL;
+    arena->curr  = NULL;
+}
+
+static size_t align_size(const size_t size) {
+    return (size + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+}
+
+void *arena_alloc(Arena *const arena, size_t size) {
+    // round up to keep the next allocation aligned
+    size = align_size(size);
+
+    ArenaBlock *block = arena->curr;
+    if (block->size - block->used < size) {
+        // reuse the next block left by a rewind, or insert a new one
+        ArenaBlock *next = block->next;
+        if (next == NULL || next->size < size) {
+            next       = new_block(max(size, arena->block_size));
+            next->next = block->next;
+        }
+        next->used  = 0;
+        block->next = next;
+        block       = next;
+        arena->curr = block;
+    }
+
+    void *const ptr  = block->data + block->used;
+    block->used     += size;
+    return ptr;
+}
+
+void *arena_realloc(Arena *const arena, void *const ptr, const size_t old_size,
+                    const size_t new_size) {
+    if (ptr == NULL) return arena_alloc(arena, new_size);
+
+    ArenaBlock *const    block = arena->curr;
+    unsigned char *const end   = block->data + block->used;
+
+    // extend in place if ptr is the last allocation and the block has room
+    if ((unsigned char *)ptr + align_size(old_size) == end &&
+        align_size(new_size) - align_size(old_size) <=
+            block->size - block->used) {
+        block->used += align_size(new_size) - align_size(old_size);
+        return ptr;
+    }
+
+    void *const new_ptr = arena_alloc(arena, new_size);
+    memcpy(new_ptr, ptr, min(old_size, new_size));
+    return new_ptr;
+}
+
+char *arena_strndup(Arena *const arena, const char *const src,
+                    const size_t n) {
+    char *const dst = arena_alloc(arena, n + 1);
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+    return dst;
+}
+
+ArenaMark arena_mark(const Arena *const arena) {
+    return (ArenaMark){.block = arena->curr, .used = arena->curr->used};
+}
+
+void arena_rewind(Arena *const arena, const ArenaMark mark) {
+    assert(mark.used <= mark.block->used);
+    mark.block->used = mark.used;
+    arena->curr      = mark.block;
+}
+
+void arena_reset(Arena *const arena) {
+    if (arena->first->next == NULL) {
+        arena->first->used = 0;
+        return;
+    }
+
+    // merge all blocks into one
+    size_t      total = 0;
+    ArenaBlock *block = arena->first;
+    while (block != NULL) {
+        ArenaBlock *const next  = block->next;
+        total                  += block->size;
+        free(block);
+        block = next;
+    }
+
+    arena->first = new_block(total);
+    arena->curr  = arena->first;
+}
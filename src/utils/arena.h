@@ -0,0 +1,71 @@
+#ifndef __UTILS_ARENA_H__
+#define __UTILS_ARENA_H__
+
+#include <stddef.h>
+
+typedef struct ArenaBlock ArenaBlock;
+
+/**
+ * A bump allocator. Memory is allocated by advancing a pointer in a block and
+ * released all at once by arena_reset.
+ */
+typedef struct {
+    ArenaBlock *first;
+    ArenaBlock *curr;
+    size_t      block_size;  // minimum size of a new block
+} Arena;
+
+/**
+ * A position in an arena to release the allocations after it.
+ */
+typedef struct {
+    ArenaBlock *block;
+    size_t      used;
+} ArenaMark;
+
+void arena_init(Arena *arena, size_t block_size);
+
+void arena_free(Arena *arena);
+
+/**
+ * @brief Allocate size bytes aligned for any type.
+ * @note The memory is valid until the next arena_reset or arena_free.
+ */
+void *arena_alloc(Arena *arena, size_t size);
+
+/**
+ * @brief Resize an allocation from old_size to new_size bytes.
+ *
+ * The allocation is extended in place if it is the last one in the arena.
+ * Otherwise its content is copied to a new allocation.
+ */
+void *arena_realloc(Arena *arena, void *ptr, size_t old_size, size_t new_size);
+
+/**
+ * @brief Copy n bytes of src into the arena and NUL-terminate the copy.
+ */
+char *arena_strndup(Arena *arena, const char *src, size_t n);
+
+/**
+ * @return The current position of the arena.
+ */
+ArenaMark arena_mark(const Arena *arena);
+
+/**
+ * @brief Release the allocations made after mark was taken.
+ *
+ * The blocks are kept and reused by later allocations, so a repeated workload
+ * rewound to the same mark is served without calling malloc.
+ */
+void arena_rewind(Arena *arena, ArenaMark mark);
+
+/**
+ * @brief Release all memory allocated from the arena.
+ *
+ * If the last use spilled into several blocks, they are merged into a single
+ * block large enough for all of them, so that a repeated workload of the same
+ * size is served without calling malloc.
+ */
+void arena_reset(Arena *arena);
+
+#endif
@@ -0,0 +1,106 @@
+#define _GNU_SOURCE
+
+#include "copy.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+
+#define COPY_BUFFER_SIZE (1 << 17)
+#define COPY_CHUNK_SIZE  (1 << 30)  // bytes moved by each kernel call
+
+typedef ssize_t (*copy_fn)(int in_fd, int out_fd);
+
+/**
+ * @return Whether an error means that the method cannot copy between the fds,
+ * so that the next one should be tried.
+ */
+static bool unsupported(const int err) {
+    return err == EINVAL || err == ENOSYS || err == EXDEV || err == EBADF ||
+           err == EOPNOTSUPP;
+}
+
+static ssize_t copy_range(const int in_fd, const int out_fd) {
+    return copy_file_range(in_fd, NULL, out_fd, NULL, COPY_CHUNK_SIZE, 0);
+}
+
+static ssize_t copy_splice(const int in_fd, const int out_fd) {
+    return splice(in_fd, NULL, out_fd, NULL, COPY_CHUNK_SIZE, SPLICE_F_MOVE);
+}
+
+static ssize_t copy_sendfile(const int in_fd, const int out_fd) {
+    return sendfile(out_fd, in_fd, NULL, COPY_CHUNK_SIZE);
+}
+
+/**
+ * @brief Copy with fn until EOF.
+ *
+ * @param [out] copied Receives the number of bytes copied.
+ * @return 0 on EOF, -1 on error, or 1 if fn cannot copy between the fds.
+ */
+static int copy_with(const copy_fn fn, const int in_fd, const int out_fd,
+                     ssize_t *const copied) {
+    while (true) {
+        const ssize_t len = fn(in_fd, out_fd);
+        if (len == 0) return 0;
+        if (len == -1) {
+            if (errno == EINTR) return -1;
+            // nothing is lost by falling back, since the file offsets
+            // are advanced by what has been copied
+            return unsupported(errno) ? 1 : -1;
+        }
+        *copied += len;
+    }
+}
+
+bool write_all(const int fd, const void *const buf, const size_t n) {
+    for (size_t written = 0; written < n;) {
+        const ssize_t len = write(fd, (const char *)buf + written, n - written);
+        if (len == -1) return false;
+        written += len;
+    }
+    return true;
+}
+
+ssize_t copy_fd(const int in_fd, const int out_fd) {
+    struct stat in_st, out_st;
+    if (fstat(in_fd, &in_st) == -1 || fstat(out_fd, &out_st) == -1) {
+        return -1;
+    }
+
+    const bool in_file  = S_ISREG(in_st.st_mode);
+    const bool out_file = S_ISREG(out_st.st_mode);
+    const bool in_pipe  = S_ISFIFO(in_st.st_mode);
+    const bool out_pipe = S_ISFIFO(out_st.st_mode);
+
+    ssize_t copied = 0;
+    int     result = 1;
+    if (result == 1 && in_file && out_file) {
+        result = copy_with(copy_range, in_fd, out_fd, &copied);
+    }
+    if (result == 1 && (in_pipe || out_pipe)) {
+        result = copy_with(copy_splice, in_fd, out_fd, &copied);
+    }
+    if (result == 1 && in_file) {
+        result = copy_with(copy_sendfile, in_fd, out_fd, &copied);
+    }
+    if (result == 0) return copied;
+    if (result == -1) return -1;
+
+    // fall back to copying through user space
+    char *const buf = malloc(COPY_BUFFER_SIZE);
+    while (true) {
+        const ssize_t len = read(in_fd, buf, COPY_BUFFER_SIZE);
+        if (len == 0) break;
+        if (len == -1 || !write_all(out_fd, buf, len)) {
+            copied = -1;
+            break;
+        }
+        copied += len;
+    }
+    free(buf);
+
+    return copied;
+}
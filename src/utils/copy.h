@@ -0,0 +1,24 @@
+#ifndef __UTILS_COPY_H__
+#define __UTILS_COPY_H__
+
+#include <stdbool.h>
+#include <unistd.h>
+
+/**
+ * @brief Copy everything from in_fd to out_fd, in the kernel if possible.
+ *
+ * Regular files are copied with copy_file_range or sendfile, and pipes with
+ * splice, so that the data is not copied through user space. Other fds are
+ * copied through a large buffer.
+ *
+ * @return The number of bytes copied, or -1 on error with errno set.
+ */
+ssize_t copy_fd(int in_fd, int out_fd);
+
+/**
+ * @brief Write all n bytes of buf to fd.
+ * @return true on success, or false on error with errno set.
+ */
+bool write_all(int fd, const void *buf, size_t n);
+
+#endif
@@ -0,0 +1,24 @@
+#include "hash.h"
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME        0x100000001b3ULL
+
+uint64_t hash_mem(const void *const data, const size_t n) {
+    const unsigned char *bytes = data;
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < n; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t hash_str(const char *str) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (; *str != '\0'; str++) {
+        hash ^= (unsigned char)*str;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
@@ -0,0 +1,23 @@
+#ifndef __UTILS_HASH_H__
+#define __UTILS_HASH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Hash a memory area with 64-bit FNV-1a.
+ *
+ * @param data Pointer to the memory area.
+ * @param n    Number of bytes to hash.
+ * @return The hash value.
+ */
+uint64_t hash_mem(const void *data, size_t n);
+
+/**
+ * @brief Hash a NUL-terminated string with 64-bit FNV-1a.
+ *
+ * @note hash_str(s) == hash_mem(s, strlen(s))
+ */
+uint64_t hash_str(const char *str);
+
+#endif
@@ -20,22 +20,11 @@ char *concat_path(const char *const base, const char *const path) {
     return ret;
 }
 
-static void  *mepcat_dest   = NULL;
-static size_t mepcat_destsz = 0;
-
-void *mepcat(void *dest, size_t destsz, const void *src, size_t n) {
-    if (dest != NULL) {
-        mepcat_dest   = dest;
-        mepcat_destsz = destsz;
-    }
-
-    if (src != NULL) {
-        const size_t copy_n  = min(n, mepcat_destsz);
-        mepcat_dest          = memcpy(mepcat_dest, src, copy_n) + copy_n;
-        mepcat_destsz       -= copy_n;
-    }
-
-    return mepcat_dest;
+void *mepcat(void *const dest, const void *const dest_end,
+             const void *const src, const size_t n) {
+    const size_t copy_n = min(n, (size_t)((const char *)dest_end -
+                                          (const char *)dest));
+    return (char *)memcpy(dest, src, copy_n) + copy_n;
 }
 
 /**
@@ -57,7 +46,8 @@ size_t tokenize(char *const str, char ***const tokens,
     StrList *curr = head;
 
     size_t token_count = 0;
-    char  *curr_token  = strtok(str, delim);
+    char  *save_ptr;
+    char  *curr_token  = strtok_r(str, delim, &save_ptr);
     while (curr_token != NULL) {
         token_count++;
 
@@ -69,7 +59,7 @@ size_t tokenize(char *const str, char ***const tokens,
         curr->next = NULL;
 
         // next token
-        curr_token = strtok(NULL, delim);
+        curr_token = strtok_r(NULL, delim, &save_ptr);
     }
 
     char **const ret_tokens = malloc((token_count + 1) * sizeof(char *));
@@ -18,25 +18,19 @@ char *concat_path(const char *base, const char *path);
 /**
  * @brief Concatenates memory areas.
  *
- * On the first call, the desination buffer and its size should be specified in
- * dest and destsz. In each subsequent call that should append to the same
- * buffer, dest must be NULL.
+ * Copies n bytes from src to dest, but never past dest_end. To append to a
+ * buffer, pass the returned pointer as dest of the next call.
  *
- * @param dest    Pointer to the destination buffer on the first call, or NULL
- * for subsequent calls
- * @param destsz  Maximum size allowed for dest on the first call
- * @param src     Pointer to the source buffer to copy from
- * @param n       Number of bytes to copy from source
+ * @param dest     Pointer to the position to write to
+ * @param dest_end Pointer to the end of the destination buffer
+ * @param src      Pointer to the source buffer to copy from
+ * @param n        Number of bytes to copy from source
  *
  * @return Pointer to the position after the last written byte in destination
  *
- * @note This function uses static variables mepcat_dest and mepcat_destsz to
- * maintain state
- * @note When dest is NULL, continues writing from last position using previous
- * state
  * @note Actual copied bytes will be minimum of n and remaining destination size
  */
-void *mepcat(void *dest, size_t destsz, const void *src, size_t n);
+void *mepcat(void *dest, const void *dest_end, const void *src, size_t n);
 
 /**
  * @brief Tokenize a string into an array of strings.
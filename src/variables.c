@@ -1,39 +1,140 @@
-#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
 
 #include "variables.h"
 
 #include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "arith.h"
+#include "executor.h"
 #include "io_helpers.h"
+#include "utils/hash.h"
 #include "utils/minmax.h"
 
-typedef struct {
-    char *key;
-    char *value;
-} Variable;
+// Variables are stored in insertion order in vars. vars_index is an open
+// addressing hash table of positions in vars, where 0 marks an empty slot and
+// i + 1 refers to vars[i].
 
-static const size_t INIT_VARS_CAPACITY = 16;
+static const size_t INIT_VARS_CAPACITY  = 16;
+static const size_t INIT_INDEX_CAPACITY = 32;  // must be a power of 2
 
 static Variable *vars          = NULL;
 static size_t    vars_len      = 0;
 static size_t    vars_capacity = 0;
 
+static size_t *vars_index          = NULL;
+static size_t  vars_index_capacity = 0;
+
+// The environment of the shell is imported into vars on first use
+extern char **environ;
+static bool   env_imported = false;
+
+// envp holds the entries of the exported variables, and is rebuilt when
+// env_generation has moved past envp_generation. Each variable keeps its own
+// entry until its value changes, so a rebuild only copies pointers.
+static char   **envp            = NULL;
+static size_t   envp_capacity   = 0;
+static uint64_t env_generation  = 1;
+static uint64_t envp_generation = 0;
+
+// Locals save the variables they shadow on a stack, which is unwound when the
+// function returns. A frame begins at an index into the stack.
+typedef struct {
+    char  *key;  // NUL-terminated copy
+    size_t key_len;
+    bool   existed;  // whether the fields below hold a variable
+    char  *value;
+    size_t value_len;
+    size_t value_capacity;
+    bool   exported;
+} SavedVariable;
+
+static SavedVariable *saved          = NULL;
+static size_t         saved_len      = 0;
+static size_t         saved_capacity = 0;
+
+static size_t *frames          = NULL;
+static size_t  n_frame         = 0;
+static size_t  frames_capacity = 0;
+
+// The exit status of the last command, kept as the variable '?'
+#define EXIT_STATUS_KEY "?"
+static int last_status = -1;
+
 void init_variables() {
-    vars          = malloc(INIT_VARS_CAPACITY * sizeof(Variable));
-    vars_capacity = INIT_VARS_CAPACITY;
+    vars                = malloc(INIT_VARS_CAPACITY * sizeof(Variable));
+    vars_capacity       = INIT_VARS_CAPACITY;
+    vars_index          = calloc(INIT_INDEX_CAPACITY, sizeof(size_t));
+    vars_index_capacity = INIT_INDEX_CAPACITY;
+    env_imported        = false;
+    last_status         = -1;
+
+    set_exit_status(0);
+}
+
+static void free_variable(Variable *const var) {
+    free(var->key);
+    free(var->value);
+    free(var->entry);
 }
 
 void free_variables() {
-    for (size_t i = 0; i < vars_len; i++) {
-        free(vars[i].key);
-        free(vars[i].value);
+    // variables of unfinished frames, e.g. in a process exiting a function
+    for (size_t i = 0; i < saved_len; i++) {
+        free(saved[i].key);
+        free(saved[i].value);
     }
+    free(saved);
+    free(frames);
+    saved     = NULL;
+    frames    = NULL;
+    saved_len = saved_capacity = n_frame = frames_capacity = 0;
+
+    for (size_t i = 0; i < vars_len; i++) free_variable(&vars[i]);
     free(vars);
+    free(vars_index);
+    free(envp);
+    envp            = NULL;
+    envp_capacity   = 0;
+    envp_generation = 0;
+}
+
+/**
+ * @return The slot in vars_index holding key, or the empty slot where key
+ * should be inserted.
+ */
+static size_t *find_slot(const char *const key, const size_t key_len,
+                         const uint64_t hash) {
+    const size_t mask = vars_index_capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        if (vars_index[i] == 0) return &vars_index[i];
+
+        const Variable *const var = &vars[vars_index[i] - 1];
+        if (var->hash == hash && var->key_len == key_len &&
+            memcmp(var->key, key, key_len) == 0) {
+            return &vars_index[i];
+        }
+    }
+}
+
+/**
+ * @brief Rebuild the index from vars, at the given capacity.
+ */
+static void rebuild_index(const size_t capacity) {
+    free(vars_index);
+    vars_index_capacity = capacity;
+    vars_index          = calloc(vars_index_capacity, sizeof(size_t));
+
+    for (size_t i = 0; i < vars_len; i++) {
+        *find_slot(vars[i].key, vars[i].key_len, vars[i].hash) = i + 1;
+    }
 }
 
-static void add_variable(const char *key, const char *value) {
+static Variable *add_variable(const char *const key, const size_t key_len,
+                              const uint64_t hash) {
     assert(vars_len <= vars_capacity);
 
     if (vars_len == vars_capacity) {
@@ -41,138 +142,455 @@ static void add_variable(const char *key, const char *value) {
         vars           = realloc(vars, vars_capacity * sizeof(Variable));
     }
 
-    vars[vars_len].key   = strdup(key);
-    vars[vars_len].value = strdup(value);
-    vars_len++;
+    // keep load factor of the index below 1/2
+    if ((vars_len + 1) * 2 > vars_index_capacity) {
+        rebuild_index(vars_index_capacity * 2);
+    }
+
+    Variable *const var = &vars[vars_len];
+    *var                = (Variable){.key            = strndup(key, key_len),
+                                     .key_len        = key_len,
+                                     .hash           = hash,
+                                     .value          = NULL,
+                                     .value_len      = 0,
+                                     .value_capacity = 0,
+                                     .exported       = false,
+                                     .entry          = NULL};
+
+    *find_slot(key, key_len, hash) = ++vars_len;
+
+    return var;
 }
 
-static Variable *find_variable(const char *const key) {
-    for (size_t i = 0; i < vars_len; i++) {
-        if (strcmp(key, vars[i].key) == 0) {
-            return &vars[i];
-        }
+static Variable *set_variable_n(const char *key, size_t key_len,
+                                const char *value, size_t value_len);
+
+/**
+ * @brief Import the environment as exported variables, once.
+ */
+static void import_environment() {
+    if (env_imported) return;
+    env_imported = true;
+
+    for (char *const *env = environ; *env != NULL; env++) {
+        const char *const eq = strchr(*env, '=');
+        if (eq == NULL || eq == *env) continue;
+
+        Variable *const var =
+            set_variable_n(*env, eq - *env, eq + 1, strlen(eq + 1));
+        var->exported = true;
+    }
+    env_generation++;
+}
+
+/**
+ * @brief Record that the environment of new processes has changed.
+ */
+static void env_changed(Variable *const var) {
+    free(var->entry);
+    var->entry = NULL;
+    env_generation++;
+}
+
+const Variable *find_variable(const char *const key, const size_t key_len) {
+    import_environment();
+
+    const size_t slot = *find_slot(key, key_len, hash_mem(key, key_len));
+    return slot == 0 ? NULL : &vars[slot - 1];
+}
+
+/**
+ * @brief Set the value of a variable, reusing its buffer if it fits.
+ */
+static Variable *set_variable_n(const char *const key, const size_t key_len,
+                                const char *const value,
+                                const size_t value_len) {
+    import_environment();
+
+    const uint64_t hash = hash_mem(key, key_len);
+    const size_t   slot = *find_slot(key, key_len, hash);
+
+    Variable *const var =
+        slot == 0 ? add_variable(key, key_len, hash) : &vars[slot - 1];
+
+    if (value_len + 1 > var->value_capacity) {
+        var->value_capacity = max(value_len + 1, var->value_capacity * 2);
+        var->value          = realloc(var->value, var->value_capacity);
     }
-    return NULL;
+    memcpy(var->value, value, value_len);
+    var->value[value_len] = '\0';
+    var->value_len        = value_len;
+
+    if (var->exported) env_changed(var);
+    return var;
 }
 
 void set_variable(const char *const key, const char *const value) {
-    Variable *var = find_variable(key);
-    if (var == NULL) {
-        add_variable(key, value);
+    set_variable_n(key, strlen(key), value, strlen(value));
+}
+
+void set_exit_status(const int status) {
+    // commands mostly succeed, so the value rarely changes
+    if (status == last_status) return;
+    last_status = status;
+
+    char      digits[16];
+    const int n_digit = snprintf(digits, sizeof(digits), "%d", status);
+    set_variable_n(EXIT_STATUS_KEY, strlen(EXIT_STATUS_KEY), digits, n_digit);
+}
+
+int get_exit_status() { return last_status; }
+
+bool export_variable(const char *const token) {
+    const char  *eq      = strchr(token, '=');
+    const size_t key_len = eq != NULL ? (size_t)(eq - token) : strlen(token);
+    if (key_len == 0) return false;
+
+    Variable *var;
+    if (eq != NULL) {
+        var = set_variable_n(token, key_len, eq + 1, strlen(eq + 1));
     } else {
+        // export an existing value, or an empty one
+        var = (Variable *)find_variable(token, key_len);
+        if (var == NULL) var = set_variable_n(token, key_len, "", 0);
+    }
+
+    if (!var->exported) {
+        var->exported = true;
+        env_changed(var);
+    }
+    return true;
+}
+
+void unset_variable(const char *const key) {
+    import_environment();
+
+    const size_t  key_len = strlen(key);
+    size_t *const slot    = find_slot(key, key_len, hash_mem(key, key_len));
+    if (*slot == 0) return;
+
+    Variable *const var = &vars[*slot - 1];
+    if (var->exported) env_generation++;
+    free_variable(var);
+
+    // No probe sequence passes the slot of the last variable, which was
+    // inserted after all others, so it is simply cleared. This is the case
+    // for the locals of a returning function.
+    if (*slot == vars_len) {
+        *slot = 0;
+        vars_len--;
+        return;
+    }
+
+    // keep the insertion order, and reindex the moved variables
+    memmove(var, var + 1, (vars + vars_len - (var + 1)) * sizeof(Variable));
+    vars_len--;
+    rebuild_index(vars_index_capacity);
+}
+
+void push_frame() {
+    if (n_frame == frames_capacity) {
+        frames_capacity = max(8, frames_capacity * 2);
+        frames          = realloc(frames, frames_capacity * sizeof(size_t));
+    }
+    frames[n_frame++] = saved_len;
+}
+
+/**
+ * @brief Save a variable before a local shadows it, unless the current frame
+ * has saved it already.
+ */
+static void save_variable(const char *const key, const size_t key_len) {
+    for (size_t i = frames[n_frame - 1]; i < saved_len; i++) {
+        if (saved[i].key_len == key_len &&
+            memcmp(saved[i].key, key, key_len) == 0) {
+            return;
+        }
+    }
+
+    if (saved_len == saved_capacity) {
+        saved_capacity = max(16, saved_capacity * 2);
+        saved = realloc(saved, saved_capacity * sizeof(SavedVariable));
+    }
+
+    SavedVariable *const entry = &saved[saved_len++];
+    *entry = (SavedVariable){.key = strndup(key, key_len), .key_len = key_len};
+
+    // the value buffer moves to the stack, and the local gets a new one
+    Variable *const var = (Variable *)find_variable(key, key_len);
+    if (var != NULL) {
+        entry->existed        = true;
+        entry->value          = var->value;
+        entry->value_len      = var->value_len;
+        entry->value_capacity = var->value_capacity;
+        entry->exported       = var->exported;
+        var->value            = NULL;
+        var->value_len        = 0;
+        var->value_capacity   = 0;
+    }
+}
+
+bool set_local(const char *const key, const size_t key_len,
+               const char *const value, const size_t value_len) {
+    if (n_frame == 0) return false;
+
+    save_variable(key, key_len);
+    if (value != NULL) {
+        set_variable_n(key, key_len, value, value_len);
+    } else {
+        char *const copy = strndup(key, key_len);
+        unset_variable(copy);
+        free(copy);
+    }
+    return true;
+}
+
+void pop_frame() {
+    assert(n_frame > 0);
+    const size_t begin = frames[--n_frame];
+
+    // in reverse, so that the variables created by the frame are removed
+    // from the end
+    while (saved_len > begin) {
+        SavedVariable *const entry = &saved[--saved_len];
+
+        if (!entry->existed) {
+            unset_variable(entry->key);
+            free(entry->key);
+            continue;
+        }
+
+        Variable *var = (Variable *)find_variable(entry->key, entry->key_len);
+        if (var == NULL) {
+            var = set_variable_n(entry->key, entry->key_len, "", 0);
+        }
+
         free(var->value);
-        var->value = strdup(value);
+        var->value          = entry->value;
+        var->value_len      = entry->value_len;
+        var->value_capacity = entry->value_capacity;
+        if (var->exported || entry->exported) env_changed(var);
+        var->exported = entry->exported;
+
+        free(entry->key);
+    }
+}
+
+char *const *get_envp() {
+    import_environment();
+    if (envp_generation == env_generation) return envp;
+
+    size_t n_entry = 0;
+    for (size_t i = 0; i < vars_len; i++) n_entry += vars[i].exported;
+
+    if (n_entry + 1 > envp_capacity) {
+        envp_capacity = max(n_entry + 1, envp_capacity * 2);
+        envp          = realloc(envp, envp_capacity * sizeof(char *));
+    }
+
+    size_t i_entry = 0;
+    for (size_t i = 0; i < vars_len; i++) {
+        Variable *const var = &vars[i];
+        if (!var->exported) continue;
+
+        // only changed variables need a new entry
+        if (var->entry == NULL) {
+            var->entry = malloc(var->key_len + var->value_len + 2);
+            memcpy(var->entry, var->key, var->key_len);
+            var->entry[var->key_len] = '=';
+            memcpy(var->entry + var->key_len + 1, var->value,
+                   var->value_len + 1);
+        }
+        envp[i_entry++] = var->entry;
     }
+    envp[i_entry] = NULL;
+
+    DEBUG_PRINT("DEBUG: Rebuilt envp with %zu entries\n", n_entry);
+    envp_generation = env_generation;
+    return envp;
+}
+
+const Variable *read_variable(const Variable *const prev) {
+    import_environment();
+
+    const Variable *const curr = prev == NULL ? vars : prev + 1;
+    return curr < vars + vars_len ? curr : NULL;
 }
 
-/*
- * @note Prereq: len(buf) >= MAX_STR_LEN + 1
+/**
+ * @brief Append n bytes of src to a NUL-terminated buffer in the arena.
+ * @return The buffer, which may have moved.
  */
-void expand_variables(char *const buf, char **tokens,
-                      const size_t token_count) {
-    // Make a copy of tokens
-    char **src_tokens = malloc(token_count * sizeof(char *));
-    for (size_t i = 0; i < token_count; i++) {
-        src_tokens[i] = strdup(tokens[i]);
-    }
-
-    size_t buf_len = 0;
-
-    for (size_t i = 0; i < token_count; i++) {
-        tokens[i] = buf + buf_len;
-
-        const char *const token             = src_tokens[i];
-        const char       *token_begin       = token;
-        bool              is_token_variable = false;
-
-        // Process buffer in batch of variables and non-variables
-        for (const char *ch = token;; ch++) {
-            if (*ch != '$' && *ch != ' ' && *ch != '\n' && *ch != '\0')
-                continue;
-
-            // process when meet end of token
-
-            size_t token_len = ch - token_begin;
-
-            if (is_token_variable && token_len > 1) {
-                // is variable and not a single '$'
-
-                // skip '$'
-                token_begin++;
-                token_len--;
-
-                // copy variable key
-                char *key = malloc(token_len + 1);
-                memcpy(key, token_begin, token_len);
-                key[token_len] = '\0';
-
-                // load variable value
-                Variable *var = find_variable(key);
-                if (var != NULL) {  // found variable
-                    const char *value = var->value;
-
-                    // concatenate variable value to result
-                    size_t res_len =
-                        min(strlen(value), (size_t)(MAX_STR_LEN - buf_len));
-                    memcpy(buf + buf_len, value, res_len);
-                    buf_len += res_len;
-                }
-                free(key);
-
-            } else {
-                // is not variable
-                size_t res_len =
-                    min(token_len, (size_t)(MAX_STR_LEN - buf_len));
-                memcpy(buf + buf_len, token_begin, res_len);
-                buf_len += res_len;
+static char *append(Arena *const arena, char *out, size_t *const len,
+                    size_t *const capacity, const char *const src,
+                    const size_t n) {
+    if (*len + n + 1 > *capacity) {
+        const size_t new_capacity = max(*len + n + 1, *capacity * 2);
+        out       = arena_realloc(arena, out, *capacity, new_capacity);
+        *capacity = new_capacity;
+    }
+    if (n > 0) memcpy(out + *len, src, n);
+    *len      += n;
+    out[*len]  = '\0';
+    return out;
+}
+
+static char *append_word(Arena *arena, char *out, size_t *len,
+                         size_t *capacity, const Word *word, bool *failed);
+
+/**
+ * @brief Append the expansion of a word part to a buffer in the arena.
+ * @param [out] failed Set if an arithmetic expansion fails, which is displayed.
+ * @return The buffer, which may have moved.
+ */
+static char *append_part(Arena *const arena, char *out, size_t *const len,
+                         size_t *const capacity, const WordPart *const part,
+                         bool *const failed) {
+    switch (part->type) {
+        case PART_LITERAL:
+            return append(arena, out, len, capacity, part->str, part->len);
+
+        case PART_VARIABLE: {
+            const Variable *var = find_variable(part->str, part->len);
+            if (var == NULL) return out;
+            return append(arena, out, len, capacity, var->value,
+                          var->value_len);
+        }
+
+        case PART_DEFAULT: {
+            // the fallback is only expanded if the variable is unset or empty
+            const Variable *var = find_variable(part->str, part->len);
+            if (var == NULL || var->value_len == 0) {
+                return append_word(arena, out, len, capacity, part->fallback,
+                                   failed);
             }
+            return append(arena, out, len, capacity, var->value,
+                          var->value_len);
+        }
 
-            // End of input
-            if (*ch == '\0') break;
+        case PART_LENGTH: {
+            const Variable *var = find_variable(part->str, part->len);
+            const size_t    length = var != NULL ? var->value_len : 0;
 
-            is_token_variable = *ch == '$';
-            token_begin       = ch;
+            char      digits[24];
+            const int n_digit = snprintf(digits, sizeof(digits), "%zu", length);
+            return append(arena, out, len, capacity, digits, n_digit);
+        }
 
-            assert(buf_len <= MAX_STR_LEN);
+        case PART_COMMAND: {
+            const char *const output = capture_output(part->program, arena);
+            return append(arena, out, len, capacity, output, strlen(output));
         }
-        buf[buf_len++] = '\0';
-    }
 
-    for (size_t i = 0; i < token_count; i++) free(src_tokens[i]);
-    free(src_tokens);
+        case PART_ARITH: {
+            long long value;
+            if (!eval_arith(part->str, part->len, &value)) {
+                *failed = true;
+                return out;
+            }
 
-    DEBUG_PRINT("DEBUG: Expanded tokens: [");
-    for (size_t i = 0; i < token_count; i++) {
-        DEBUG_PRINT("%s", tokens[i]);
-        if (i < token_count - 1) {
-            DEBUG_PRINT(", ");
+            char      digits[24];
+            const int n_digit = snprintf(digits, sizeof(digits), "%lld", value);
+            return append(arena, out, len, capacity, digits, n_digit);
         }
     }
-    DEBUG_PRINT("] (len: %zu)\n", buf_len);
+    return out;
 }
 
-bool exec_assignment(const char *const token) {
-    const char *eq = strchr(token, '=');
-    if (eq == NULL) return false;
+/**
+ * @brief Append the expansion of a word to a buffer in the arena, streaming
+ * each part without intermediate copies.
+ * @return The buffer, which may have moved.
+ */
+static char *append_word(Arena *const arena, char *out, size_t *const len,
+                         size_t *const capacity, const Word *const word,
+                         bool *const failed) {
+    for (size_t i = 0; i < word->n_part && !*failed; i++) {
+        out = append_part(arena, out, len, capacity, &word->parts[i], failed);
+    }
+    return out;
+}
 
-    const size_t key_len = eq - token;
-    if (key_len == 0) return false;
-    const size_t value_len = strlen(eq + 1);
+char *expand_word(const Word *const word, Arena *const arena) {
+    char  *out      = NULL;
+    size_t len      = 0;
+    size_t capacity = 0;
+    bool   failed   = false;
 
-    char *key   = malloc(key_len + 1);
-    char *value = malloc(value_len + 1);
+    out = append_word(arena, out, &len, &capacity, word, &failed);
+    if (failed) return NULL;
 
-    memcpy(key, token, key_len);
-    key[key_len] = '\0';
+    // empty word
+    if (out == NULL) out = append(arena, out, &len, &capacity, NULL, 0);
 
-    memcpy(value, eq + 1, value_len);
-    value[value_len] = '\0';
+    return out;
+}
 
-    DEBUG_PRINT("DEBUG: Executing assignment: %s\n", token);
-    set_variable(key, value);
+/**
+ * @return Whether ch can be part of a variable name in text.
+ */
+static bool is_name_char(const char ch) {
+    return isalnum((unsigned char)ch) || ch == '_';
+}
 
-    free(key);
-    free(value);
+char *expand_variables(const char *const text, Arena *const arena) {
+    char  *out      = NULL;
+    size_t len      = 0;
+    size_t capacity = 0;
+    bool   failed   = false;
+
+    const char *ch = text;
+    while (*ch != '\0') {
+        const char *const begin = ch;
+
+        // parsed like in words; on a syntax error, the '$' is literal
+        WordPart part = {.type = PART_LITERAL};
+        if (*ch == '$' && ch[1] == '(' && ch[2] == '(') {
+            parse_arithmetic(&ch, &part);
+        } else if (*ch == '$' && ch[1] == '(') {
+            part.type    = PART_COMMAND;
+            part.program = parse_substitution(&ch, arena);
+            if (part.program == NULL && ch != begin) continue;
+        } else if (*ch == '$' && ch[1] == '{') {
+            parse_parameter(&ch, arena, &part);
+        } else if (*ch == '$' && is_name_char(ch[1])) {
+            // the name runs over letters, digits and '_'
+            part = (WordPart){.type = PART_VARIABLE, .str = ++ch};
+            while (is_name_char(*ch)) ch++;
+            part.len = ch - part.str;
+        } else if (*ch == '$' && ch[1] == EXIT_STATUS_KEY[0]) {
+            part = (WordPart){.type = PART_VARIABLE, .str = ++ch, .len = 1};
+            ch++;
+        }
+
+        if (ch != begin) {
+            out = append_part(arena, out, &len, &capacity, &part, &failed);
+            if (failed) return NULL;
+            continue;
+        }
+
+        ch  = strchrnul(ch + 1, '$');
+        out = append(arena, out, &len, &capacity, begin, ch - begin);
+    }
+
+    if (out == NULL) out = append(arena, out, &len, &capacity, NULL, 0);
+
+    return out;
+}
+
+bool is_assignment(const char *const token) {
+    const char *eq = strchr(token, '=');
+    return eq != NULL && eq != token;
+}
+
+bool exec_assignment(const char *const token) {
+    if (!is_assignment(token)) return false;
+
+    const char  *eq      = strchr(token, '=');
+    const size_t key_len = eq - token;
+
+    DEBUG_PRINT("DEBUG: Executing assignment: %s\n", token);
+    set_variable_n(token, key_len, eq + 1, strlen(eq + 1));
 
     return true;
 }
@@ -3,21 +3,144 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
+#include "parser.h"
+#include "utils/arena.h"
+
+typedef struct {
+    char    *key;
+    size_t   key_len;
+    uint64_t hash;
+    char    *value;
+    size_t   value_len;
+    size_t   value_capacity;
+    bool     exported;  // passed to the environment of new processes
+    char    *entry;     // "key=value" in the environment, NULL until built
+} Variable;
+
+/**
+ * @brief Initialize the variables. The environment is imported as exported
+ * variables when the variables are first used.
+ */
 void init_variables();
 
 void free_variables();
 
-void expand_variables(char *buf, char **tokens, size_t token_count);
+/**
+ * @brief Find a variable by key.
+ *
+ * @param [in] key Pointer to the key, which need not be NUL-terminated.
+ * @param [in] key_len Length of the key.
+ * @return The variable, or NULL if not found.
+ */
+const Variable *find_variable(const char *key, size_t key_len);
+
+/**
+ * @brief Set the value of a variable, creating it if it does not exist.
+ */
+void set_variable(const char *key, const char *value);
+
+/**
+ * @brief Set the exit status of the last command, which expands as $?.
+ */
+void set_exit_status(int status);
+
+/**
+ * @return The exit status of the last command.
+ */
+int get_exit_status();
+
+/**
+ * @brief Export a variable to the environment of new processes.
+ *
+ * @param [in] token "key" to export a variable, creating it empty if it does
+ * not exist, or "key=value" to also set it.
+ * @return false if the key is empty.
+ */
+bool export_variable(const char *token);
+
+/**
+ * @brief Remove a variable, and from the environment if it is exported.
+ */
+void unset_variable(const char *key);
+
+/**
+ * @brief Begin a frame for the local variables of a function call.
+ */
+void push_frame();
+
+/**
+ * @brief End the current frame, restoring the variables its locals shadow.
+ */
+void pop_frame();
+
+/**
+ * @brief Set a variable local to the current frame.
+ *
+ * The variable it shadows is moved aside, not copied, and only on the first
+ * call for the key in the frame.
+ *
+ * @param [in] key Pointer to the key, which need not be NUL-terminated.
+ * @param [in] key_len Length of the key.
+ * @param [in] value The value, or NULL to unset the variable in the frame.
+ * @param [in] value_len Length of the value.
+ * @return false if no frame has begun.
+ */
+bool set_local(const char *key, size_t key_len, const char *value,
+               size_t value_len);
+
+/**
+ * @brief Get the environment for new processes.
+ *
+ * The array is cached, and only rebuilt after an exported variable has
+ * changed.
+ *
+ * @return A NULL-terminated array of "key=value" entries, valid until the next
+ * change to the variables.
+ */
+char *const *get_envp();
+
+/**
+ * @brief Iterate over the variables in the order they were created.
+ *
+ * @param [in] prev The previous variable, or NULL to get the first one.
+ * @return The next variable, or NULL if there are no more variables.
+ */
+const Variable *read_variable(const Variable *prev);
+
+/**
+ * @brief Expand a word by concatenating its parts.
+ *
+ * @param word [in] The word to expand.
+ * @param arena [in] Arena owning the expanded string.
+ * @return The expanded string, or NULL if an arithmetic expansion has failed,
+ * which is displayed.
+ */
+char *expand_word(const Word *word, Arena *arena);
+
+/**
+ * @brief Expand the variables in a text, such as the body of a heredoc.
+ *
+ * Unlike in words, a variable name consists of letters, digits and '_' only.
+ * Command substitutions are parsed and run as they are found.
+ *
+ * @param text [in] The text to expand.
+ * @param arena [in] Arena owning the expanded string.
+ * @return The expanded string, or NULL like expand_word.
+ */
+char *expand_variables(const char *text, Arena *arena);
+
+/*
+ * @brief Check if the token is an assignment without executing it.
+ */
+bool is_assignment(const char *token);
 
 /*
  * @brief Check if the token is an assignment.
  * If it is, split the token into key and value.
  *
  * @return true if the token is an assignment, false otherwise.
- *
- * @note Prereq: size of key >= size of token,
- *               size of rvalue >= size of token.
  */
 bool exec_assignment(const char *token);
 
@@ -0,0 +1,35 @@
+#!/usr/bin/env bash
+#
+# Check the output of arithmetic expansions.
+#
+# Usage: tests/arith.sh [mysh]
+#
+# Each case is a line of mysh and its expected output, which includes the
+# exit status when the line prints $?.
+
+set -uo pipefail
+
+MYSH=${1:-src/mysh}
+
+failed=0
+
+check() {
+    local line=$1 expected=$2 actual
+    actual=$("$MYSH" -c "$line" 2> /dev/null)
+    if [[ $actual != "$expected" ]]; then
+        printf 'FAIL: %s\n  expected: %s\n  actual:   %s\n' \
+               "$line" "$expected" "$actual"
+        failed=1
+    fi
+}
+
+check 'echo $((1 + 2 * 3))'                 '7'
+check 'x=4; echo $((x + 1)) $(($x + 1))'    '5 5'
+check 'x=4; echo $((${x} + 1))'             '5'
+check 'x=4; echo $((${x}*${x}))'            '16'
+check 'echo $((${unset} + 1))'              '1'
+check 'echo $((1 / 0)); echo $?'            '1'
+check 'echo $((${x)); echo $?'              '1'
+
+if [[ $failed == 0 ]]; then echo "All arithmetic checks passed"; fi
+exit $failed
@@ -0,0 +1,51 @@
+#!/usr/bin/env bash
+#
+# Check scripts run in batch mode, from a file and from a pipe.
+#
+# Usage: tests/batch.sh [mysh]
+#
+# Each case is a script and its expected output, followed by the exit status
+# of mysh. The last command of a script runs in place of the shell, so its
+# status must still be the one of mysh.
+
+set -uo pipefail
+
+MYSH=${1:-src/mysh}
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+failed=0
+
+report() {
+    local how=$1 script=$2 expected=$3 actual=$4
+    if [[ $actual != "$expected" ]]; then
+        printf 'FAIL (%s): %s\n  expected: %s\n  actual:   %s\n' \
+               "$how" "$script" "$expected" "$actual"
+        failed=1
+    fi
+}
+
+check() {
+    local script=$1 expected=$2 actual
+    printf '%s\n' "$script" > "$dir/script"
+
+    actual=$("$MYSH" "$dir/script" 2> /dev/null; echo "status $?")
+    report file "$script" "$expected" "$actual"
+
+    actual=$(printf '%s\n' "$script" | "$MYSH" 2> /dev/null; echo "status $?")
+    report pipe "$script" "$expected" "$actual"
+}
+
+check $'echo a\necho b'                          $'a\nb\nstatus 0'
+check $'if true; then\necho in\nfi'              $'in\nstatus 0'
+check $'cat <<END\nbody\nEND\necho after'        $'body\nafter\nstatus 0'
+check $'x=4\necho $x'                            $'4\nstatus 0'
+check $'echo a\nexit 5\necho no'                 $'a\nstatus 5'
+check $'echo a\nfalse'                           $'a\nstatus 1'
+check $'echo $(echo sub)\n/bin/echo last'        $'sub\nlast\nstatus 0'
+check $'echo a\n/bin/false'                      $'a\nstatus 1'
+check 'nosuchcommand'                            $'status 127'
+
+if [[ $failed == 0 ]]; then echo "All batch checks passed"; fi
+exit $failed
@@ -0,0 +1,41 @@
+#!/usr/bin/env bash
+#
+# Check the calls of shell functions.
+#
+# Usage: tests/functions.sh [mysh]
+#
+# Each case is a line of mysh and its expected output, which includes the
+# exit status when the line prints $?.
+
+set -uo pipefail
+
+MYSH=${1:-src/mysh}
+
+failed=0
+
+check() {
+    local line=$1 expected=$2 actual
+    actual=$("$MYSH" -c "$line" 2> /dev/null)
+    if [[ $actual != "$expected" ]]; then
+        printf 'FAIL: %s\n  expected: %s\n  actual:   %s\n' \
+               "$line" "$expected" "$actual"
+        failed=1
+    fi
+}
+
+check 'f() { echo $# $1 $2; }; f a b c'                   '3 a b'
+check 'f() { echo $@; }; f 1 2 3'                         '1 2 3'
+check 'f() { return 3; }; f; echo $?'                     '3'
+check 'f() { false; }; f; echo $?'                        '1'
+check 'f() { echo a; return; echo b; }; f'                'a'
+check 'f() { x=in; }; x=out; f; echo $x'                  'in'
+check 'f() { local x=in; echo $x; }; x=out; f; echo $x'   $'in\nout'
+check 'f() { echo one; }; f() { echo two; }; f'           'two'
+check 'echo() { printf fn; }; echo x'                     'fn'
+check 'f() { echo $1; }; f a | cat'                       'a'
+check 'f() { exit 4; echo no; }; f; echo no; echo $?'     ''
+check 'n() { if [ $1 -gt 0 ]; then echo $1; n $(($1 - 1)); fi; }; n 3' \
+      $'3\n2\n1'
+
+if [[ $failed == 0 ]]; then echo "All function checks passed"; fi
+exit $failed
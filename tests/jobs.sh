@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+#
+# Check the order of background jobs, and the queue of MYSH_MAX_JOBS.
+#
+# Usage: tests/jobs.sh [mysh]
+#
+# Each case is a line of mysh and its expected output. Job notices, the lines
+# starting with '[', are left out since they hold pids. The jobs run `late`,
+# which waits a number of tenths of a second before printing its word.
+
+set -uo pipefail
+
+MYSH=${1:-src/mysh}
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+printf '#!/bin/sh\nsleep 0.$1\necho $2\n' > "$dir/late"
+chmod +x "$dir/late"
+late=$dir/late
+
+failed=0
+
+check() {
+    local line=$1 expected=$2 actual
+    actual=$("$MYSH" -c "$line" 2> /dev/null | grep -v '^\[')
+    if [[ $actual != "$expected" ]]; then
+        printf 'FAIL: %s\n  expected: %s\n  actual:   %s\n' \
+               "$line" "$expected" "$actual"
+        failed=1
+    fi
+}
+
+check "$late 3 a & $late 1 b & wait"                         $'b\na'
+check "$late 1 a & wait %1; echo \$?"                         $'a\n0'
+check "MYSH_MAX_JOBS=1; $late 3 a & $late 1 b & wait"        $'a\nb'
+check "MYSH_MAX_JOBS=1; $late 2 a & $late 1 b & jobs | wc -l; wait" \
+      $'2\na\nb'
+check "MYSH_MAX_JOBS=1; $late 2 a & $late 1 b & kill %2; wait" 'a'
+check "MYSH_MAX_JOBS=1; $late 2 a & x=\$($late 1 b); echo x=\$x; wait" \
+      $'x=b\na'
+
+if [[ $failed == 0 ]]; then echo "All job checks passed"; fi
+exit $failed
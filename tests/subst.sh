@@ -0,0 +1,40 @@
+#!/usr/bin/env bash
+#
+# Check the output of command substitutions.
+#
+# Usage: tests/subst.sh [mysh]
+#
+# Each case is a line of mysh and its expected output. Lists which change the
+# shell run in a child, so the cases also check that the shell is unchanged.
+
+set -uo pipefail
+
+MYSH=${1:-src/mysh}
+
+failed=0
+
+check() {
+    local line=$1 expected=$2 actual
+    actual=$("$MYSH" -c "$line" 2> /dev/null)
+    if [[ $actual != "$expected" ]]; then
+        printf 'FAIL: %s\n  expected: %s\n  actual:   %s\n' \
+               "$line" "$expected" "$actual"
+        failed=1
+    fi
+}
+
+check 'echo $(echo a b)'                          'a b'
+check 'x=$(echo hi); echo $x'                     'hi'
+check 'echo pre$(echo mid)post'                   'premidpost'
+check 'echo $(echo $(echo deep))'                 'deep'
+check 'echo $(echo x > /dev/null)end'             'end'
+check 'x=$(echo a | cat); echo $x'                'a'
+check 'echo $(for i in 1 2 3; do echo $i; done)'  $'1\n2\n3'
+check 'x=5; y=$(x=6; echo $x); echo $x $y'        '5 6'
+check 'cd /; echo $(cd /usr; pwd); pwd'           $'/usr\n/'
+check 'echo $(exit 2; echo no)end'                'end'
+check 'f() { echo in $1; }; echo $(f a)'          'in a'
+check 'echo $(g() { echo g; }; g); g'             'g'
+
+if [[ $failed == 0 ]]; then echo "All substitution checks passed"; fi
+exit $failed